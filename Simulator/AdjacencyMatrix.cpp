@@ -1,5 +1,18 @@
 #include "AdjacencyMatrix.h"
+#include "Profiler.h"
 #include <cassert>
+#include <queue>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ADJACENCYMATRIX_SSE2
+#endif
+
+namespace {
+constexpr int tileSize = 64; // 64 x 64 floats and ints of a tile fit into L1 together
+constexpr int parallelMinNodes = 256; // below this starting threads costs more than the pass
+}
 
 //--------------------------------------------------------------------------------------------------------------
 // AdjacencyMatrix
@@ -11,18 +24,19 @@ bool AdjacencyMatrix::pushNode(const Node& node) {
     return false;
 
   ++length_;
-  for (auto& row : distanceData_)
-    row.push_back(std::numeric_limits<float>::infinity());
-  distanceData_.push_back(std::vector<float>(length_, std::numeric_limits<float>::infinity()));
+  distanceData_.push(std::numeric_limits<float>::infinity());
   nodes_.push_back(node);
 
   // Initialize the predecessor matrix
-  for (auto& row : predecessor_)
-    row.push_back(-1);
-  predecessor_.push_back(std::vector<int>(length_, -1));
+  predecessor_.push(-1);
+  adjacency_.emplace_back();
 
   // Distance to itself is 0
-  distanceData_.back()[length_ - 1] = 0;
+  distanceData_[length_ - 1][length_ - 1] = 0;
+
+  // an unconnected node does not change any shortest path, maintained matrices stay valid
+  if (!allPairs_)
+    dirty_ = true;
 
   return true;
 }
@@ -34,23 +48,146 @@ void AdjacencyMatrix::addDistance(const Node& nodeFrom, const Node& nodeTo, floa
   int fromIndex = find(nodeFrom).value();
   int toIndex = find(nodeTo).value();
 
-  distanceData_[fromIndex][toIndex] = dist;
-  distanceData_[toIndex][fromIndex] = dist;
-  predecessor_[fromIndex][toIndex] = fromIndex;
-  predecessor_[toIndex][fromIndex] = toIndex;
+  auto setNeighbor = [this, dist](int from, int to) -> std::optional<float> {
+    auto it = std::ranges::find_if(adjacency_[from], [to](const auto& edge) { return std::get<0>(edge) == to; });
+    if (it == adjacency_[from].end()) {
+      adjacency_[from].push_back({ to, dist });
+      return std::nullopt;
+    }
+    float previous = std::get<1>(*it);
+    std::get<1>(*it) = dist;
+    return previous;
+  };
+  std::optional<float> previous = setNeighbor(fromIndex, toIndex);
+  setNeighbor(toIndex, fromIndex);
+
+  if (!allPairs_) {
+    dirty_ = true;
+    distanceData_[fromIndex][toIndex] = dist;
+    distanceData_[toIndex][fromIndex] = dist;
+    predecessor_[fromIndex][toIndex] = fromIndex;
+    predecessor_[toIndex][fromIndex] = toIndex;
+    return;
+  }
+
+  // a longer edge can invalidate any path through it, only shorter or new edges can be patched in
+  if (previous.has_value() && dist > previous.value()) {
+    dirty_ = true;
+    updateShortestPaths();
+  }
+  else
+    insertEdge(fromIndex, toIndex, dist);
+}
+
+//------ maintainAllPairs ------
+void AdjacencyMatrix::maintainAllPairs(bool enable) {
+  if (enable)
+    updateShortestPaths();
+  allPairs_ = enable;
+}
+
+//------ insertEdge ------
+// Every shortest path that improves uses the new edge exactly once, either as a -> b or as b -> a, so the old
+// rows of a and b are enough to update the whole matrix in O(n^2).
+void AdjacencyMatrix::insertEdge(int a, int b, float dist) {
+  if (distanceData_[a][b] <= dist)
+    return;
+
+  std::vector<float> distA(distanceData_[a], distanceData_[a] + length_);
+  std::vector<float> distB(distanceData_[b], distanceData_[b] + length_);
+  std::vector<int> predA(predecessor_[a], predecessor_[a] + length_);
+  std::vector<int> predB(predecessor_[b], predecessor_[b] + length_);
+
+  for (int i = 0; i < length_; ++i) {
+    float* distRow = distanceData_[i];
+    int* predRow = predecessor_[i];
+    for (int j = 0; j < length_; ++j) {
+      if (float viaAB = distA[i] + dist + distB[j]; viaAB < distRow[j]) {
+        distRow[j] = viaAB;
+        predRow[j] = j == b ? a : predB[j];
+      }
+      if (float viaBA = distB[i] + dist + distA[j]; viaBA < distRow[j]) {
+        distRow[j] = viaBA;
+        predRow[j] = j == a ? b : predA[j];
+      }
+    }
+  }
+}
+
+//------ updateShortestPaths ------
+// Computes into scratch matrices built from the edge lists and only then replaces both published matrices,
+// so they are never seen half updated and an exception leaves the previous result intact.
+bool AdjacencyMatrix::updateShortestPaths(Kernel kernel) {
+  if (!dirty_)
+    return false;
+
+  SquareMatrix<float> dist(length_, std::numeric_limits<float>::infinity());
+  SquareMatrix<int> pred(length_, -1);
+  for (int i = 0; i < length_; ++i) {
+    dist[i][i] = 0;
+    for (auto [neighbor, d] : adjacency_[i]) {
+      dist[i][neighbor] = d;
+      pred[i][neighbor] = i;
+    }
+  }
+  runFloydWarshall(dist, pred, kernel, threads_);
+
+  distanceData_ = std::move(dist);
+  predecessor_ = std::move(pred);
+  dirty_ = false;
+  return true;
 }
 
 //------ goTo ------
 std::vector<Node> const AdjacencyMatrix::goTo(const Node& nodeFrom, const Node& nodeTo) {
-   assert(contains(nodeTo) && contains(nodeFrom));
+  PROFILE_SCOPE("AdjacencyMatrix::goTo");
+  assert(contains(nodeTo) && contains(nodeFrom));
 
-  int fromIndex = find(nodeFrom).value();
-  int toIndex = find(nodeTo).value();
+  int from = find(nodeFrom).value();
+  int to = find(nodeTo).value();
+  if (allPairs_)
+    return pathFromPredecessors(from, to);
+  if (from == to)
+    return {};
+
+  std::vector<float> cost(length_, std::numeric_limits<float>::infinity());
+  std::vector<int> parent(length_, -1);
 
-  int from = fromIndex;
-  int to = toIndex;
+  using Entry = std::tuple<float, float, int>; // estimated total cost, cost so far, node
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+  cost[from] = 0;
+  open.push({ heuristic(from, to), 0.0f, from });
+  while (!open.empty()) {
+    auto [estimate, nodeCost, node] = open.top();
+    open.pop();
+    if (node == to)
+      break;
+    if (nodeCost > cost[node])
+      continue; // stale entry
+
+    for (auto [neighbor, dist] : adjacency_[node]) {
+      if (cost[node] + dist < cost[neighbor]) {
+        cost[neighbor] = cost[node] + dist;
+        parent[neighbor] = node;
+        open.push({ cost[neighbor] + heuristic(neighbor, to), cost[neighbor], neighbor });
+      }
+    }
+  }
+
+  if (parent[to] == -1)
+    return {};
 
   std::vector<Node> ret;
+  for (int node = to; node != from; node = parent[node])
+    ret.push_back(nodes_[node]);
+  std::reverse(ret.begin(), ret.end());
+  return ret;
+}
+
+//------ pathFromPredecessors ------
+std::vector<Node> AdjacencyMatrix::pathFromPredecessors(int from, int to) const {
+  std::vector<Node> ret;
 
   ret.push_back(nodes_[to]);
   while (true) {
@@ -66,31 +203,197 @@ std::vector<Node> const AdjacencyMatrix::goTo(const Node& nodeFrom, const Node&
 }
 
 //------ find ------
+// Two nodes are equal when both coordinates differ by less than the tolerance, so with cells of that size a
+// match can only lie in the 3 x 3 cells around the node. Returns the lowest index like a linear scan would.
 std::optional<int> AdjacencyMatrix::find(const Node& node) const {
-  for (int i = 0; auto it : nodes_) {
-    if (node == it)
-      return i;
-    ++i;
+  PROFILE_COUNT("AdjacencyMatrix::find", 1);
+  if (Pos::tolerance_ <= 0)
+    return std::nullopt; // nothing compares equal without tolerance
+
+  if (cellSize_ != Pos::tolerance_ || hashed_ > (int)nodes_.size()) {
+    cells_.clear();
+    cellSize_ = Pos::tolerance_;
+    hashed_ = 0;
+  }
+  while (hashed_ < (int)nodes_.size())
+    hashNode(hashed_++);
+
+  int x = cell(node.x.val);
+  int y = cell(node.y.val);
+  std::optional<int> ret;
+  for (int dx = -1; dx <= 1; ++dx) {
+    for (int dy = -1; dy <= 1; ++dy) {
+      auto it = cells_.find(cellKey(x + dx, y + dy));
+      if (it == cells_.end())
+        continue;
+      for (int index : it->second) {
+        if (nodes_[index] == node && (!ret.has_value() || index < ret.value()))
+          ret = index;
+      }
+    }
   }
-  return std::nullopt;
+  return ret;
 }
 
+//------ hashNode ------
+void AdjacencyMatrix::hashNode(int index) const {
+  cells_[cellKey(cell(nodes_[index].x.val), cell(nodes_[index].y.val))].push_back(index);
+}
 
 //------ floydWarshall ------
-void AdjacencyMatrix::floydWarshall() {
-  std::vector<std::vector<float>> dist = distanceData_;
-
-  // Floyd-Warshall algorithm
-  for (int k = 0; k < length_; ++k) {
-    for (int i = 0; i < length_; ++i) {
-      for (int j = 0; j < length_; ++j) {
-        if (dist[i][k] < std::numeric_limits<float>::infinity() && dist[k][j] < std::numeric_limits<float>::infinity()) {
-          if (dist[i][j] > dist[i][k] + dist[k][j]) {
-            dist[i][j] = dist[i][k] + dist[k][j];
-            predecessor_[i][j] = predecessor_[k][j];
+void AdjacencyMatrix::floydWarshall(Kernel kernel) {
+  runFloydWarshall(distanceData_, predecessor_, kernel, threads_);
+}
+
+//------ runFloydWarshall ------
+void AdjacencyMatrix::runFloydWarshall(SquareMatrix<float>& dist, SquareMatrix<int>& pred, Kernel kernel, unsigned threads) {
+  PROFILE_SCOPE("AdjacencyMatrix::floydWarshall");
+  int length = dist.size();
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  if (threads > 1 && length >= parallelMinNodes) {
+    parallelFloydWarshall(dist, pred, std::min(threads, (unsigned)length), kernel);
+    return;
+  }
+
+  if (kernel == Kernel::SCALAR) {
+    // Floyd-Warshall algorithm, rows are contiguous so the j loop streams through memory
+    for (int k = 0; k < length; ++k) {
+      const float* distK = dist[k];
+      const int* predK = pred[k];
+      for (int i = 0; i < length; ++i) {
+        float* distI = dist[i];
+        int* predI = pred[i];
+        for (int j = 0; j < length; ++j) {
+          if (distI[k] < std::numeric_limits<float>::infinity() && distK[j] < std::numeric_limits<float>::infinity()) {
+            if (distI[j] > distI[k] + distK[j]) {
+              distI[j] = distI[k] + distK[j];
+              predI[j] = predK[j];
+            }
           }
         }
       }
     }
+    return;
+  }
+
+  blockedFloydWarshall(dist, pred, kernel == Kernel::SIMD, 0, 1, nullptr);
+}
+
+//------ blockedFloydWarshall ------
+// Per block of k first the diagonal tile, then the tiles in its row and column, then all remaining tiles, which
+// only read the finished row and column tiles. The tiles of one phase do not read each other, so thread of threads
+// relaxes every threads-th of them and sync separates the phases. Each tile sees the same values in the same
+// order at any thread count.
+void AdjacencyMatrix::blockedFloydWarshall(SquareMatrix<float>& dist, SquareMatrix<int>& pred, bool simd,
+                                           unsigned thread, unsigned threads, std::barrier<>* sync) {
+  int length = dist.size();
+  auto phaseEnd = [sync] {
+    if (sync)
+      sync->arrive_and_wait();
+  };
+
+  for (int kb = 0; kb < length; kb += tileSize) {
+    int kEnd = std::min(kb + tileSize, length);
+
+    if (thread == 0)
+      relaxTile(dist, pred, kb, kEnd, kb, kEnd, kb, kEnd, simd);
+    phaseEnd();
+
+    unsigned tile = 0;
+    for (int b = 0; b < length; b += tileSize) {
+      if (b == kb)
+        continue;
+      int bEnd = std::min(b + tileSize, length);
+      if (tile++ % threads == thread)
+        relaxTile(dist, pred, kb, kEnd, kb, kEnd, b, bEnd, simd);
+      if (tile++ % threads == thread)
+        relaxTile(dist, pred, kb, kEnd, b, bEnd, kb, kEnd, simd);
+    }
+    phaseEnd();
+
+    tile = 0;
+    for (int ib = 0; ib < length; ib += tileSize) {
+      if (ib == kb)
+        continue;
+      int iEnd = std::min(ib + tileSize, length);
+      for (int jb = 0; jb < length; jb += tileSize) {
+        if (jb == kb || tile++ % threads != thread)
+          continue;
+        relaxTile(dist, pred, kb, kEnd, ib, iEnd, jb, std::min(jb + tileSize, length), simd);
+      }
+    }
+    phaseEnd();
+  }
+}
+
+//------ parallelFloydWarshall ------
+// SCALAR: every thread owns a contiguous block of rows and relaxes it for one k, then all threads meet at the
+// barrier before the next k. Rows are only written by their owner and row k is only read, so there is no race.
+// BLOCKED and SIMD run the tile phases of blockedFloydWarshall() on all threads.
+void AdjacencyMatrix::parallelFloydWarshall(SquareMatrix<float>& dist, SquareMatrix<int>& pred, unsigned threads, Kernel kernel) {
+  int length = dist.size();
+  std::barrier sync((std::ptrdiff_t)threads);
+
+  auto worker = [&dist, &pred, length, threads, kernel, &sync](unsigned thread) {
+    if (kernel != Kernel::SCALAR) {
+      blockedFloydWarshall(dist, pred, kernel == Kernel::SIMD, thread, threads, &sync);
+      return;
+    }
+    int iBegin = (int)((long long)length * thread / threads);
+    int iEnd = (int)((long long)length * (thread + 1) / threads);
+    for (int k = 0; k < length; ++k) {
+      relaxTile(dist, pred, k, k + 1, iBegin, iEnd, 0, length, false);
+      sync.arrive_and_wait();
+    }
+  };
+
+  std::vector<std::jthread> workers;
+  for (unsigned thread = 1; thread < threads; ++thread)
+    workers.emplace_back(worker, thread);
+  worker(0);
+}
+
+//------ relaxTile ------
+// Relaxes dist[i][j] over dist[i][k] + dist[k][j] without branching in the j loop. Infinity needs no special
+// case: inf + x stays inf and never compares less.
+void AdjacencyMatrix::relaxTile(SquareMatrix<float>& dist, SquareMatrix<int>& pred, int kBegin, int kEnd, int iBegin,
+                                int iEnd, int jBegin, int jEnd, bool simd) {
+  for (int k = kBegin; k < kEnd; ++k) {
+    const float* distK = dist[k];
+    const int* predK = pred[k];
+    for (int i = iBegin; i < iEnd; ++i) {
+      if (i == k)
+        continue; // dist[k][k] is 0, row k cannot improve over itself
+      float* distI = dist[i];
+      int* predI = pred[i];
+      float distIK = distI[k];
+      if (distIK == std::numeric_limits<float>::infinity())
+        continue;
+
+      int j = jBegin;
+#ifdef ADJACENCYMATRIX_SSE2
+      if (simd) {
+        const __m128 vDistIK = _mm_set1_ps(distIK);
+        for (; j + 4 <= jEnd; j += 4) {
+          __m128 candidate = _mm_add_ps(vDistIK, _mm_loadu_ps(distK + j));
+          __m128 current = _mm_loadu_ps(distI + j);
+          __m128 shorter = _mm_cmplt_ps(candidate, current);
+          _mm_storeu_ps(distI + j, _mm_min_ps(candidate, current));
+
+          __m128i mask = _mm_castps_si128(shorter);
+          __m128i predCurrent = _mm_loadu_si128((const __m128i*)(predI + j));
+          __m128i predVia = _mm_loadu_si128((const __m128i*)(predK + j));
+          _mm_storeu_si128((__m128i*)(predI + j), _mm_or_si128(_mm_and_si128(mask, predVia), _mm_andnot_si128(mask, predCurrent)));
+        }
+      }
+#endif
+      for (; j < jEnd; ++j) {
+        float candidate = distIK + distK[j];
+        bool shorter = candidate < distI[j];
+        distI[j] = shorter ? candidate : distI[j];
+        predI[j] = shorter ? predK[j] : predI[j];
+      }
+    }
   }
-}
\ No newline at end of file
+}
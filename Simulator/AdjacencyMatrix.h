@@ -2,7 +2,17 @@
 
 #include <vector>
 #include <optional>
-#include <set>
+#include <tuple>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <cstdint>
+#include <unordered_map>
+#include <barrier>
 #include "Sensor.h"
 
 enum CardinalOrientation {
@@ -13,23 +23,37 @@ enum CardinalOrientation {
 };
 
 struct Orientation {
-  using is_transparent = std::true_type;
-
   CardinalOrientation o;
 
-  Orientation(Orientation::CardinalOrientation o) : o(o) {}
+  constexpr Orientation(CardinalOrientation o) : o(o) {}
 
-  Orientation turnRight() const { if (o == WEST) return NORTH; else return (CardinalOrientation)(o + 1); }
-  Orientation turnLeft() const { if (o == NORTH) return WEST; else return (CardinalOrientation)(o - 1); }
-  Orientation turnBack() const { return turnRight().turnRight(); }
+  constexpr Orientation turnRight() const { return (CardinalOrientation)((o + 1) & 3); }
+  constexpr Orientation turnLeft() const { return (CardinalOrientation)((o + 3) & 3); }
+  constexpr Orientation turnBack() const { return (CardinalOrientation)((o + 2) & 3); }
 
-  auto operator <=> (const Orientation& rhs) const = default;
+  constexpr auto operator <=> (const Orientation& rhs) const = default;
 };
 
-struct OrientationComparator {
-  bool operator () (const Orientation& lhs, const std::tuple<Orientation, bool>& rhs) const { return lhs.o < std::get<0>(rhs); }
-  bool operator () (const std::tuple<Orientation, bool>& lhs, const Orientation& rhs) const { return std::get<0>(lhs) < rhs.o; }
-  bool operator () (const std::tuple<Orientation, bool>& lhs, const std::tuple<Orientation, bool>& rhs) const { return std::get<0>(lhs) < std::get<0>(rhs).o; }
+//--------------------------------------------------------------------------------------------------------------
+// Junction
+//--------------------------------------------------------------------------------------------------------------
+
+// The paths leaving a junction, bit o of the low nibble is set when there is a path towards orientation o and
+// bit o of the high nibble once it has been driven.
+struct Junction {
+  constexpr bool open(Orientation orientation) const { return bits_ & bit(orientation); }
+  constexpr bool visited(Orientation orientation) const { return bits_ & (bit(orientation) << 4); }
+
+  constexpr void mark(Orientation orientation, bool visited) {
+    bits_ |= bit(orientation);
+    if (visited)
+      bits_ |= bit(orientation) << 4;
+  }
+
+private:
+  static constexpr std::uint8_t bit(Orientation orientation) { return (std::uint8_t)(1 << orientation.o); }
+
+  std::uint8_t bits_{0};
 };
 
 //--------------------------------------------------------------------------------------------------------------
@@ -38,7 +62,7 @@ struct OrientationComparator {
 
 
 struct Pos {
-  static inline float tolerance_{ 0.0f };
+  static inline thread_local float tolerance_{ 0.0f };
 
   using is_transparent = std::true_type;
 
@@ -65,7 +89,7 @@ struct Node {
   Node(Pos x, Pos y) : x(x), y(y) {}
   Node() = default;
 
-  std::set<std::tuple<Orientation, /*visited*/ bool>, OrientationComparator> junction;
+  Junction junction;
 
   bool operator == (const Node& rhs) const { return x == rhs.x && y == rhs.y; };
 
@@ -73,11 +97,94 @@ struct Node {
   Pos y;
 };
 
+static_assert(std::is_trivially_copyable_v<Node>);
+
+using NodeId = std::uint32_t; // index of a Node in PathFinder's node arena
+
+//--------------------------------------------------------------------------------------------------------------
+// SquareMatrix
+//--------------------------------------------------------------------------------------------------------------
+
+// n x n matrix in one row-major buffer. The row stride is the capacity, which doubles when a node is pushed into
+// a full matrix, so pushing a node is amortized O(n) with a single allocation. Rows start on 32 byte boundaries.
+template <typename T>
+struct SquareMatrix {
+  static constexpr std::size_t alignment = 32;
+  static constexpr int rowPadding = (int)(alignment / sizeof(T));
+
+  T* operator [] (int row)                              { return data_.get() + (std::size_t)row * stride_; }
+  const T* operator [] (int row) const                  { return data_.get() + (std::size_t)row * stride_; }
+
+  int size() const                                      { return size_; }
+  int stride() const                                    { return stride_; }
+
+  // appends a row and a column set to value
+  void push(T value) {
+    if (size_ == stride_) {
+      int stride = std::max(rowPadding, 2 * stride_);
+      Buffer data(new (std::align_val_t(alignment)) T[(std::size_t)stride * stride]);
+      for (int row = 0; row < size_; ++row)
+        std::copy_n((*this)[row], size_, data.get() + (std::size_t)row * stride);
+      data_ = std::move(data);
+      stride_ = stride;
+    }
+    for (int row = 0; row < size_; ++row)
+      (*this)[row][size_] = value;
+    ++size_;
+    std::fill_n((*this)[size_ - 1], size_, value);
+  }
+
+  void fill(T value) {
+    for (int row = 0; row < size_; ++row)
+      std::fill_n((*this)[row], size_, value);
+  }
+
+  SquareMatrix() = default;
+  SquareMatrix(int size, T value) {
+    stride_ = (size + rowPadding - 1) / rowPadding * rowPadding;
+    data_.reset(stride_ ? new (std::align_val_t(alignment)) T[(std::size_t)stride_ * stride_] : nullptr);
+    size_ = size;
+    fill(value);
+  }
+  SquareMatrix(const SquareMatrix& rhs) { *this = rhs; }
+  SquareMatrix(SquareMatrix&& rhs) { *this = std::move(rhs); }
+  SquareMatrix& operator = (SquareMatrix&& rhs) {
+    data_ = std::move(rhs.data_);
+    size_ = std::exchange(rhs.size_, 0);
+    stride_ = std::exchange(rhs.stride_, 0);
+    return *this;
+  }
+  SquareMatrix& operator = (const SquareMatrix& rhs) {
+    if (this == &rhs)
+      return *this;
+    data_.reset(rhs.stride_ ? new (std::align_val_t(alignment)) T[(std::size_t)rhs.stride_ * rhs.stride_] : nullptr);
+    size_ = rhs.size_;
+    stride_ = rhs.stride_;
+    for (int row = 0; row < size_; ++row)
+      std::copy_n(rhs[row], size_, (*this)[row]);
+    return *this;
+  }
+
+private:
+  struct Delete { void operator () (T* p) const { ::operator delete[](p, std::align_val_t(alignment)); } };
+  using Buffer = std::unique_ptr<T[], Delete>;
+
+  Buffer data_;
+  int size_{0};
+  int stride_{0};
+};
+
 //--------------------------------------------------------------------------------------------------------------
 // AdjacencyMatrix
 //--------------------------------------------------------------------------------------------------------------
 
 struct AdjacencyMatrix {
+  enum class Kernel {
+    SCALAR,  // plain triple loop
+    BLOCKED, // cache sized tiles, branch free scalar inner loop
+    SIMD,    // cache sized tiles, SSE2 inner loop
+  };
+
   bool pushNode(const Node& node);
 
   void addDistance(const Node& nodeFrom, const Node& nodeTo, float dist);
@@ -88,14 +195,60 @@ struct AdjacencyMatrix {
     return find(node).has_value();
   }
 
+  // shortest path from -> to without from, A* over adjacency_ with a manhattan heuristic,
+  // or read from the predecessor matrix while all pairs are maintained
   std::vector<Node> const goTo(const Node& from, const Node& to);
 
-  void floydWarshall();
+  // keeps the distance and predecessor matrices valid on every addDistance(), O(n^2) per new edge
+  void maintainAllPairs(bool enable);
+
+  // Publishes shortest paths for the current edges, skipped when nothing changed since the last call.
+  // Returns whether a pass was run.
+  bool updateShortestPaths(Kernel kernel = Kernel::SIMD);
+
+  // raw pass over the current matrix contents in place
+  void floydWarshall(Kernel kernel = Kernel::SIMD);
+
+  // > 1 spreads every pass across threads, 0 uses all cores. Each kernel keeps its own order of relaxations, so
+  // the result is identical to the same kernel on one thread: SCALAR splits the rows of every k, BLOCKED and SIMD
+  // split the tiles of each phase of a k block.
+  void setThreads(unsigned threads)                     { threads_ = threads; }
+
+  float distance(int from, int to) const                { return distanceData_[from][to]; }
+  int predecessor(int from, int to) const               { return predecessor_[from][to]; } // of to on the path, -1 if none
+  int size() const                                      { return length_; }
 
   std::vector<Node> nodes_; // order of Nodes
 
 private:
-  std::vector<std::vector<float>> distanceData_;
+  void insertEdge(int a, int b, float dist);
+  std::vector<Node> pathFromPredecessors(int from, int to) const;
+
+  static void runFloydWarshall(SquareMatrix<float>& dist, SquareMatrix<int>& pred, Kernel kernel, unsigned threads);
+  static void relaxTile(SquareMatrix<float>& dist, SquareMatrix<int>& pred, int kBegin, int kEnd, int iBegin, int iEnd,
+                        int jBegin, int jEnd, bool simd);
+  static void blockedFloydWarshall(SquareMatrix<float>& dist, SquareMatrix<int>& pred, bool simd, unsigned thread,
+                                   unsigned threads, std::barrier<>* sync);
+  static void parallelFloydWarshall(SquareMatrix<float>& dist, SquareMatrix<int>& pred, unsigned threads, Kernel kernel);
+
+  // spatial hash over nodes_ with cells of Pos::tolerance_, rebuilt when the tolerance changes
+  static std::int64_t cellKey(int x, int y) { return ((std::int64_t)x << 32) | (std::uint32_t)y; }
+  int cell(float v) const { return (int)std::floor(v / cellSize_); }
+  void hashNode(int index) const;
+
+  float heuristic(int from, int to) const {
+    return std::abs(nodes_[from].x.val - nodes_[to].x.val) + std::abs(nodes_[from].y.val - nodes_[to].y.val);
+  }
+
+  SquareMatrix<float> distanceData_;
   int length_{0};
-  std::vector<std::vector<int>> predecessor_;
+  SquareMatrix<int> predecessor_;
+  std::vector<std::vector<std::tuple<int, /*dist*/ float>>> adjacency_; // sparse neighbours of each node
+  bool allPairs_{false};
+  bool dirty_{false}; // distanceData_ / predecessor_ do not hold the shortest paths of the current edges
+  unsigned threads_{1};
+
+  mutable std::unordered_map<std::int64_t, std::vector<int>> cells_;
+  mutable float cellSize_{0};
+  mutable int hashed_{0}; // nodes_[0, hashed_) are in cells_
 };
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "HeadlessEngine.h"
+#include "WorkStealingPool.h"
+#include "MazeIO.h"
+#include "MazeGenerator.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+
+using namespace sf;
+
+//--------------------------------------------------------------------------------------------------------------
+// Sweep
+//--------------------------------------------------------------------------------------------------------------
+
+struct Run {
+  std::string maze;
+  PathFinder::Parameters parameters;
+  float step;
+  HeadlessResult result;
+};
+
+// "1.3,1.5,1.7" -> { 1.3, 1.5, 1.7 }, throws std::invalid_argument or std::out_of_range on anything else
+std::vector<float> parseList(const std::string& list) {
+  std::vector<float> values;
+  std::istringstream fields(list);
+  std::string value;
+  while (std::getline(fields, value, ',')) {
+    std::size_t used = 0;
+    values.push_back(std::stof(value, &used));
+    if (used != value.size())
+      throw std::invalid_argument(value);
+  }
+  if (values.empty())
+    throw std::invalid_argument(list);
+  return values;
+}
+
+// field in double quotes, quotes inside doubled
+std::string csvQuoted(const std::string& field) {
+  std::string quoted = "\"";
+  for (char c : field) {
+    if (c == '"')
+      quoted += '"';
+    quoted += c;
+  }
+  return quoted + "\"";
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------------------
+
+// usage: BatchRunner [mazeDir] [--threshold 1.5,...] [--offset 3.7,...] [--step 0.3,...] [--start x,y]
+//                    [--max-steps n] [--threads n] [--out results.csv]
+// Runs every maze in mazeDir (the built-in maze without one) with every combination of parameters. The car starts
+// at --start, by default in MazeGenerator::start() of each maze, or at 100,1000 in the built-in one. Runs that
+// end at the first junction count as not finished.
+int main(int argc, char* argv[]) {
+  std::filesystem::path mazeDir;
+  std::vector<float> thresholds{1.5f};
+  std::vector<float> offsets{3.7f};
+  std::vector<float> steps{0.3f};
+  std::optional<Vector2f> start;
+  long maxSteps = 10'000'000;
+  unsigned threads = std::thread::hardware_concurrency();
+  std::string out;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    try {
+      if (arg == "--threshold" && hasValue)
+        thresholds = parseList(argv[++i]);
+      else if (arg == "--offset" && hasValue)
+        offsets = parseList(argv[++i]);
+      else if (arg == "--step" && hasValue)
+        steps = parseList(argv[++i]);
+      else if (arg == "--start" && hasValue) {
+        std::vector<float> xy = parseList(argv[++i]);
+        if (xy.size() != 2)
+          throw std::invalid_argument(argv[i]);
+        start = Vector2f(xy[0], xy[1]);
+      }
+      else if (arg == "--max-steps" && hasValue)
+        maxSteps = std::stol(argv[++i]);
+      else if (arg == "--threads" && hasValue)
+        threads = (unsigned)std::stoul(argv[++i]);
+      else if (arg == "--out" && hasValue)
+        out = argv[++i];
+      else if (!arg.starts_with("--"))
+        mazeDir = arg;
+      else {
+        std::cerr << "unknown option " << arg << "\n";
+        return 2;
+      }
+    }
+    catch (const std::logic_error&) { // invalid_argument and out_of_range
+      std::cerr << "invalid value " << argv[i] << " for " << arg << "\n";
+      return 2;
+    }
+  }
+
+  std::vector<std::pair<std::string, Maze>> mazes;
+  if (mazeDir.empty())
+    mazes.push_back({ "builtin", defaultMaze() });
+  else {
+    std::vector<std::filesystem::path> files;
+    for (auto& entry : std::filesystem::directory_iterator(mazeDir)) {
+      if (entry.is_regular_file())
+        files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+    for (auto& file : files) {
+      if (auto maze = loadMaze(file); maze.has_value() && !maze->empty())
+        mazes.push_back({ file.filename().string(), std::move(maze.value()) });
+    }
+  }
+  if (mazes.empty()) {
+    std::cerr << "no mazes found in " << mazeDir << "\n";
+    return 1;
+  }
+
+  std::vector<Run> runs;
+  for (auto& [name, maze] : mazes) {
+    for (float threshold : thresholds) {
+      for (float offset : offsets) {
+        for (float step : steps)
+          runs.push_back({ name, { .wallThreshold = threshold, .junctionOffset = offset }, step, {} });
+      }
+    }
+  }
+
+  {
+    WorkStealingPool pool(threads);
+    for (std::size_t i = 0, m = 0; m < mazes.size(); ++m) {
+      std::size_t perMaze = thresholds.size() * offsets.size() * steps.size();
+      for (std::size_t end = i + perMaze; i < end; ++i) {
+        Vector2f from = start.value_or(mazeDir.empty() ? Vector2f(100, 1000) : MazeGenerator::start(mazes[m].second));
+        pool.submit([&run = runs[i], &maze = mazes[m].second, from, maxSteps] {
+          HeadlessEngine engine(from, maze);
+          engine.pathFinder.setParameters(run.parameters);
+          engine.pathFinder.setStep(run.step);
+          run.result = engine.run(maxSteps);
+        });
+      }
+    }
+    pool.wait();
+  }
+
+  std::ofstream file;
+  if (!out.empty())
+    file.open(out);
+  std::ostream& csv = out.empty() ? std::cout : file;
+
+  csv << "maze,wall_threshold,junction_offset,step,finished,time_s,steps,distance,collisions,nodes\n";
+  for (auto& run : runs) {
+    csv << csvQuoted(run.maze) << "," << run.parameters.wallThreshold << "," << run.parameters.junctionOffset << "," << run.step << ","
+        << run.result.finished << "," << run.result.time.count() << "," << run.result.steps << "," << run.result.distance << ","
+        << run.result.collisions << "," << run.result.nodes << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,566 @@
+#include "AdjacencyMatrix.h"
+#include "HeadlessEngine.h"
+#include "MazeGenerator.h"
+
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <string>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace sf;
+
+//--------------------------------------------------------------------------------------------------------------
+// Harness
+//--------------------------------------------------------------------------------------------------------------
+
+//------ processCpuSeconds ------
+// User and system time of all threads of the process so far.
+double processCpuSeconds() {
+#ifdef _WIN32
+  FILETIME creation, exit, kernel, user;
+  GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+  auto seconds = [](const FILETIME& time) {
+    return (double)(((std::uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime) * 100e-9;
+  };
+  return seconds(kernel) + seconds(user);
+#else
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  auto seconds = [](const timeval& time) { return (double)time.tv_sec + (double)time.tv_usec * 1e-6; };
+  return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+#endif
+}
+
+struct Result {
+  std::string name;
+  long iterations;
+  double seconds;    // all iterations together
+  double cpuSeconds; // process CPU time of all iterations, more than seconds when several threads work
+  double items;      // work items per iteration, e.g. nodes pushed
+
+  double nsPerIteration() const { return seconds * 1e9 / (double)iterations; }
+  double cpuNsPerIteration() const { return cpuSeconds * 1e9 / (double)iterations; }
+  double itemsPerSecond() const { return items * (double)iterations / seconds; }
+};
+
+// measured results are added here, so the optimizer can not drop the work
+volatile float sink;
+
+struct Suite {
+  // Runs f(n), which has to do n iterations, with growing n until one run takes at least minTime, like
+  // Google Benchmark does.
+  template <typename F>
+  void run(const std::string& name, double items, F&& f) {
+    if (!filter.empty() && name.find(filter) == std::string::npos)
+      return;
+
+    for (long n = 1;;) {
+      double cpuStart = processCpuSeconds();
+      auto start = std::chrono::steady_clock::now();
+      f(n);
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      double cpuSeconds = processCpuSeconds() - cpuStart;
+
+      if (seconds >= minTime || n >= 1'000'000'000) {
+        results.push_back({ name, n, seconds, cpuSeconds, items });
+        const Result& result = results.back();
+        std::cout << std::left << std::setw(56) << name << std::right << std::setw(12) << n << std::setw(16)
+                  << std::fixed << std::setprecision(1) << result.nsPerIteration() << std::setw(16)
+                  << std::scientific << std::setprecision(3) << result.itemsPerSecond() << std::defaultfloat << "\n";
+        return;
+      }
+      double factor = seconds > 0 ? minTime * 1.4 / seconds : 10.0;
+      n = std::max(n + 1, (long)((double)n * std::min(factor, 10.0)));
+    }
+  }
+
+  void writeJson(std::ostream& out) const;
+
+  std::string filter;  // only names containing it run
+  double minTime{0.2}; // seconds per benchmark
+  std::vector<Result> results;
+};
+
+//------ writeJson ------
+// Same layout as Google Benchmark's --benchmark_format=json, so its compare.py and dashboards can read it.
+void Suite::writeJson(std::ostream& out) const {
+  std::time_t now = std::time(nullptr);
+  char date[32];
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+#ifdef NDEBUG
+  const char* build = "release";
+#else
+  const char* build = "debug";
+#endif
+
+  out << "{\n  \"context\": {\n"
+      << "    \"date\": \"" << date << "\",\n"
+      << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+      << "    \"library_build_type\": \"" << build << "\"\n"
+      << "  },\n  \"benchmarks\": [";
+  out << std::setprecision(10);
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const Result& result = results[i];
+    out << (i == 0 ? "\n" : ",\n")
+        << "    {\"name\": \"" << result.name << "\", \"run_type\": \"iteration\", \"iterations\": " << result.iterations
+        << ", \"real_time\": " << result.nsPerIteration() << ", \"cpu_time\": " << result.cpuNsPerIteration()
+        << ", \"time_unit\": \"ns\", \"items_per_second\": " << result.itemsPerSecond() << "}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// Graphs
+//--------------------------------------------------------------------------------------------------------------
+
+// Junction graph like the ones the maze generator produces: nodes on a square grid, each linked to its right
+// and lower neighbour with probability link. Integer weights keep all kernels bit identical in distance,
+// fractional ones are what the PathFinder's travelled distances give.
+AdjacencyMatrix gridGraph(int size, unsigned seed, double link = 0.6, bool fractional = false) {
+  Pos::setTolerance(1);
+  std::mt19937 random(seed);
+  std::bernoulli_distribution linked(link);
+  std::uniform_real_distribution<float> length(1, 21);
+  auto weight = [&](std::mt19937& random) { return fractional ? length(random) : std::floor(length(random)); };
+
+  int side = 1;
+  while (side * side < size)
+    ++side;
+
+  AdjacencyMatrix graph;
+  for (int i = 0; i < size; ++i)
+    graph.pushNode(Node((float)(i % side) * 10, (float)(i / side) * 10));
+
+  for (int i = 0; i < size; ++i) {
+    if (i % side + 1 < side && i + 1 < size && linked(random))
+      graph.addDistance(graph.nodes_[i], graph.nodes_[i + 1], weight(random));
+    if (i + side < size && linked(random))
+      graph.addDistance(graph.nodes_[i], graph.nodes_[i + side], weight(random));
+  }
+  return graph;
+}
+
+//------ ulps ------
+// Number of floats between a and b, 0 for equal values including equal infinities.
+std::int64_t ulps(float a, float b) {
+  if (a == b)
+    return 0;
+  if (std::isinf(a) || std::isinf(b))
+    return std::numeric_limits<std::int64_t>::max();
+  auto ordered = [](float f) {
+    std::int32_t bits = std::bit_cast<std::int32_t>(f);
+    return bits < 0 ? (std::int64_t)std::numeric_limits<std::int32_t>::min() - bits : (std::int64_t)bits;
+  };
+  return std::abs(ordered(a) - ordered(b));
+}
+
+//------ compareShortestPaths ------
+// run against reference, two passes over the edges in graph. Distances have to agree within maxUlps, and the
+// predecessors of run have to lead back from j to i over edges adding up to distance(i, j) within maxUlps, ties
+// may be broken differently. samePredecessors requires equal distances and predecessors instead, for the same
+// kernel on other thread counts. Only every rowStep-th row is walked. Returns the first difference, empty if
+// there is none.
+std::string compareShortestPaths(const AdjacencyMatrix& graph, const AdjacencyMatrix& run, const AdjacencyMatrix& reference,
+                                 std::int64_t maxUlps, bool samePredecessors, int rowStep = 1) {
+  int size = graph.size();
+  for (int i = 0; i < size; ++i) {
+    for (int j = 0; j < size; ++j) {
+      if (ulps(run.distance(i, j), reference.distance(i, j)) > (samePredecessors ? 0 : maxUlps)) {
+        return "distance(" + std::to_string(i) + ", " + std::to_string(j) + ") " + std::to_string(run.distance(i, j)) +
+               " instead of " + std::to_string(reference.distance(i, j));
+      }
+      if (samePredecessors && run.predecessor(i, j) != reference.predecessor(i, j))
+        return "predecessor(" + std::to_string(i) + ", " + std::to_string(j) + ")";
+    }
+  }
+
+  for (int i = 0; i < size; i += rowStep) {
+    for (int j = 0; j < size; ++j) {
+      if (i == j || std::isinf(run.distance(i, j)))
+        continue;
+      float length = 0;
+      int steps = 0;
+      for (int node = j; node != i; ++steps) {
+        int previous = run.predecessor(i, node);
+        if (previous < 0 || steps == size || std::isinf(graph.distance(previous, node)))
+          return "path " + std::to_string(i) + " -> " + std::to_string(j) + " is broken at " + std::to_string(node);
+        length += graph.distance(previous, node);
+        node = previous;
+      }
+      if (ulps(length, run.distance(i, j)) > maxUlps)
+        return "path " + std::to_string(i) + " -> " + std::to_string(j) + " is " + std::to_string(length) +
+               " long instead of " + std::to_string(run.distance(i, j));
+    }
+  }
+  return {};
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// Benchmarks
+//--------------------------------------------------------------------------------------------------------------
+
+//------ graphBenchmarks ------
+void graphBenchmarks(Suite& suite, int size) {
+  std::string n = "/" + std::to_string(size);
+  AdjacencyMatrix graph = gridGraph(size, 42);
+
+  // a new graph per iteration, the matrices grow by one row and column per node
+  suite.run("AdjacencyMatrix::pushNode" + n, size, [&](long iterations) {
+    for (long i = 0; i < iterations; ++i) {
+      AdjacencyMatrix nodes;
+      for (const Node& node : graph.nodes_)
+        nodes.pushNode(node);
+      sink = sink + (float)nodes.size();
+    }
+  });
+
+  // sets every existing edge again, two find() and an edge list scan each
+  std::vector<std::tuple<Node, Node, float>> edges;
+  for (int i = 0; i < size; ++i) {
+    for (int j = i + 1; j < size; ++j) {
+      if (graph.distance(i, j) != std::numeric_limits<float>::infinity())
+        edges.push_back({ graph.nodes_[i], graph.nodes_[j], graph.distance(i, j) });
+    }
+  }
+  suite.run("AdjacencyMatrix::addDistance" + n, (double)edges.size(), [&](long iterations) {
+    for (long i = 0; i < iterations; ++i) {
+      for (auto& [from, to, dist] : edges)
+        graph.addDistance(from, to, dist);
+    }
+  });
+
+  suite.run("AdjacencyMatrix::find" + n, size, [&](long iterations) {
+    for (long i = 0; i < iterations; ++i) {
+      for (const Node& node : graph.nodes_)
+        sink = sink + (float)graph.find(node).value_or(-1);
+    }
+  });
+
+  // corner to corner over a grid without missing links, once searched and once read from all pairs
+  AdjacencyMatrix full = gridGraph(size, 42, 1.0);
+  Node from = full.nodes_.front();
+  Node to = full.nodes_.back();
+  suite.run("AdjacencyMatrix::goTo/astar" + n, 1, [&](long iterations) {
+    for (long i = 0; i < iterations; ++i)
+      sink = sink + (float)full.goTo(from, to).size();
+  });
+  full.maintainAllPairs(true);
+  suite.run("AdjacencyMatrix::goTo/allPairs" + n, 1, [&](long iterations) {
+    for (long i = 0; i < iterations; ++i)
+      sink = sink + (float)full.goTo(from, to).size();
+  });
+}
+
+//------ floydWarshallBenchmarks ------
+// Every kernel on the same graph, checked against the first one that ran (scalar unless filtered out) and, on
+// other thread counts, against the same kernel. Then an update of an unchanged graph, which has to skip the pass.
+// Returns false on a mismatch or a recomputation.
+bool floydWarshallBenchmarks(Suite& suite, int size) {
+  std::string n = "/" + std::to_string(size);
+  AdjacencyMatrix graph = gridGraph(size, 42);
+
+  unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::tuple<AdjacencyMatrix::Kernel, unsigned, std::string>> kernels = {
+    { AdjacencyMatrix::Kernel::SCALAR, 1, "scalar" },
+    { AdjacencyMatrix::Kernel::BLOCKED, 1, "blocked" },
+    { AdjacencyMatrix::Kernel::SIMD, 1, "simd" },
+    { AdjacencyMatrix::Kernel::SIMD, cores, "simd_x" + std::to_string(cores) },
+  };
+
+  bool same = true;
+  std::optional<AdjacencyMatrix> reference;
+  std::string referenceName; // first kernel that ran, the filter may have skipped scalar
+  std::optional<AdjacencyMatrix> previous; // kernel that ran last, compared exactly if the next is the same kernel
+  std::optional<AdjacencyMatrix::Kernel> previousKernel;
+  for (auto& [kernel, threads, name] : kernels) {
+    std::optional<AdjacencyMatrix> last;
+    suite.run("AdjacencyMatrix::floydWarshall/" + name + n, 1, [&](long iterations) {
+      for (long i = 0; i < iterations; ++i) {
+        AdjacencyMatrix run = graph; // O(n^2) copy next to the O(n^3) pass
+        run.setThreads(threads);
+        run.floydWarshall(kernel);
+        if (i + 1 == iterations)
+          last = std::move(run);
+      }
+    });
+    if (!last.has_value())
+      continue; // filtered out
+    if (!reference.has_value()) {
+      reference = last;
+      referenceName = name;
+    }
+
+    // integer weights, so distances are exact, the paths are walked for 32 rows
+    std::string difference = compareShortestPaths(graph, *last, *reference, 0, false, std::max(1, size / 32));
+    if (difference.empty() && previousKernel == kernel)
+      difference = compareShortestPaths(graph, *last, *previous, 0, true, size);
+    if (!difference.empty()) {
+      std::cerr << "floydWarshall/" << name << n << " differs from " << (previousKernel == kernel ? "the same kernel on one thread" : referenceName)
+                << ": " << difference << "\n";
+      same = false;
+    }
+    previous = std::move(last);
+    previousKernel = kernel;
+  }
+
+  // second update on an unchanged graph has to be a no-op
+  AdjacencyMatrix cached = graph;
+  cached.updateShortestPaths();
+  long recomputed = 0;
+  suite.run("AdjacencyMatrix::updateShortestPaths/unchanged" + n, 1, [&](long iterations) {
+    for (long i = 0; i < iterations; ++i)
+      recomputed += cached.updateShortestPaths();
+  });
+  if (recomputed > 0) {
+    std::cerr << "updateShortestPaths/unchanged" << n << " RECOMPUTED " << recomputed << " times\n";
+    same = false;
+  }
+  return same;
+}
+
+//------ simulatorBenchmarks ------
+void simulatorBenchmarks(Suite& suite) {
+  // all five sensors of a car in the middle of generated mazes, the wall grid keeps the cost independent of size
+  for (int side : { 8, 32, 128 }) {
+    Simulator sim(true, MazeGenerator(side, side, 1).generate(MazeAlgorithm::BACKTRACKER));
+    Car* pCar = (Car*)sim.car.get();
+    pCar->move2(MazeGenerator::cellCenter(side / 2, side / 2));
+
+    suite.run("DistanceSensor::measureDistance/" + std::to_string(sim.walls.size()), 5, [&](long iterations) {
+      for (long i = 0; i < iterations; ++i) {
+        for (const DistanceSensor& sensor : pCar->sensors)
+          sink = sink + sensor.measureDistance();
+      }
+    });
+  }
+
+  Simulator sim(true, MazeGenerator(8, 8, 1).generate(MazeAlgorithm::BACKTRACKER));
+  Car* pCar = (Car*)sim.car.get();
+  pCar->move2(MazeGenerator::cellCenter(0, 0));
+
+  // four turns bring the car back to where it started
+  suite.run("Car::backTrackedTurn90", 4, [&](long iterations) {
+    for (long i = 0; i < iterations; ++i) {
+      for (int turn = 0; turn < 4; ++turn)
+        sink = sink + (float)pCar->backTrackedTurn90(true);
+    }
+  });
+
+  suite.run("Car::backTrackedMove/free", 2, [&](long iterations) {
+    for (long i = 0; i < iterations; ++i) {
+      sink = sink + (float)pCar->backTrackedMove(pCar->front);
+      sink = sink + (float)pCar->backTrackedMove(-pCar->front);
+    }
+  });
+
+  // pressed against a wall, every move is refused
+  pCar->sweptMove(pCar->front * 1000.0f);
+  suite.run("Car::backTrackedMove/blocked", 1, [&](long iterations) {
+    for (long i = 0; i < iterations; ++i)
+      sink = sink + (float)pCar->backTrackedMove(pCar->front);
+  });
+
+  // whole exploration of the built-in maze including building it, items are search() steps
+  long steps = HeadlessEngine().run(10'000'000).steps;
+  suite.run("HeadlessEngine::run/builtin", (double)steps, [&](long iterations) {
+    for (long i = 0; i < iterations; ++i) {
+      HeadlessEngine engine;
+      sink = sink + engine.run(10'000'000).distance;
+    }
+  });
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// Checks
+//--------------------------------------------------------------------------------------------------------------
+
+//------ allPairsCheck ------
+// Random graphs growing the way exploration grows them: nodes pushed along the way, new edges, edges set again
+// shorter (patched by insertEdge) and longer (full rebuild). After every addDistance() the maintained matrix has
+// to equal a scalar Floyd-Warshall over a copy holding just the edges, and every goTo() path has to follow those
+// edges with the length distance(i, j). Returns false on a mismatch.
+bool allPairsCheck() {
+  Pos::setTolerance(1);
+  for (unsigned seed = 1; seed <= 16; ++seed) {
+    std::mt19937 random(seed);
+    int size = std::uniform_int_distribution<int>(8, 48)(random);
+    std::uniform_int_distribution<int> weight(1, 20);
+
+    AdjacencyMatrix maintained;
+    AdjacencyMatrix edges; // no all pairs, addDistance() only writes the edge into the matrix
+    maintained.maintainAllPairs(true);
+    std::vector<std::pair<int, int>> added;
+
+    for (int step = 0; step < 3 * size; ++step) {
+      if (maintained.size() < size && (maintained.size() < 2 || random() % 4 == 0)) {
+        Node node((float)(maintained.size() % 8) * 10, (float)(maintained.size() / 8) * 10);
+        maintained.pushNode(node);
+        edges.pushNode(node);
+        continue;
+      }
+
+      int a, b;
+      if (!added.empty() && random() % 3 == 0) {
+        std::tie(a, b) = added[random() % added.size()];
+      }
+      else {
+        std::uniform_int_distribution<int> node(0, maintained.size() - 1);
+        a = node(random);
+        b = node(random);
+        if (a == b)
+          continue;
+        added.push_back({ a, b });
+      }
+      float dist = (float)weight(random);
+      maintained.addDistance(maintained.nodes_[a], maintained.nodes_[b], dist);
+      edges.addDistance(edges.nodes_[a], edges.nodes_[b], dist);
+
+      AdjacencyMatrix reference = edges;
+      reference.floydWarshall(AdjacencyMatrix::Kernel::SCALAR);
+      for (int i = 0; i < reference.size(); ++i) {
+        for (int j = 0; j < reference.size(); ++j) {
+          if (maintained.distance(i, j) != reference.distance(i, j)) {
+            std::cerr << "maintained all pairs differ from scalar floydWarshall: seed " << seed << ", step " << step
+                      << ", distance(" << i << ", " << j << ") " << maintained.distance(i, j) << " instead of "
+                      << reference.distance(i, j) << "\n";
+            return false;
+          }
+        }
+      }
+
+      // goTo() has to walk existing edges from i to j and add up to distance(i, j)
+      for (int i = 0; i < maintained.size(); ++i) {
+        for (int j = 0; j < maintained.size(); ++j) {
+          if (i == j)
+            continue;
+          std::vector<Node> path = maintained.goTo(maintained.nodes_[i], maintained.nodes_[j]);
+          int last = i;
+          float length = 0;
+          bool connected = true;
+          for (auto& node : path) {
+            int next = maintained.find(node).value();
+            connected = connected && edges.distance(last, next) != std::numeric_limits<float>::infinity();
+            length += edges.distance(last, next);
+            last = next;
+          }
+          bool reachable = maintained.distance(i, j) != std::numeric_limits<float>::infinity();
+          if (reachable ? !connected || last != j || length != maintained.distance(i, j) : !path.empty()) {
+            std::cerr << "maintained all pairs path broken: seed " << seed << ", step " << step << ", goTo(" << i
+                      << ", " << j << ") ends in " << last << " after " << length << " instead of "
+                      << maintained.distance(i, j) << "\n";
+            return false;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+//------ kernelCheck ------
+// Fractional weights on graphs large enough to run threaded: every kernel on 1 and 4 threads against the scalar
+// one within kernelUlps, and each kernel on 4 threads exactly like on 1. The paths are walked in every case.
+// Returns false on a mismatch.
+bool kernelCheck() {
+  constexpr std::int64_t kernelUlps = 64; // kernels add the same path in another order
+  std::vector<std::tuple<AdjacencyMatrix::Kernel, std::string>> kernels = {
+    { AdjacencyMatrix::Kernel::SCALAR, "scalar" },
+    { AdjacencyMatrix::Kernel::BLOCKED, "blocked" },
+    { AdjacencyMatrix::Kernel::SIMD, "simd" },
+  };
+
+  for (unsigned seed = 1; seed <= 3; ++seed) {
+    AdjacencyMatrix graph = gridGraph(300, seed, 0.8, true);
+    AdjacencyMatrix reference = graph;
+    reference.floydWarshall(AdjacencyMatrix::Kernel::SCALAR);
+
+    for (auto& [kernel, name] : kernels) {
+      AdjacencyMatrix serial = graph;
+      serial.floydWarshall(kernel);
+      AdjacencyMatrix threaded = graph;
+      threaded.setThreads(4);
+      threaded.floydWarshall(kernel);
+
+      for (auto [run, against, ulps, samePredecessors, what] : {
+             std::tuple{ &serial, &reference, kernelUlps, false, "" },
+             std::tuple{ &threaded, &serial, kernelUlps, true, " on 4 threads" } }) {
+        if (std::string difference = compareShortestPaths(graph, *run, *against, ulps, samePredecessors); !difference.empty()) {
+          std::cerr << "floydWarshall/" << name << what << " differs with fractional weights, seed " << seed << ": "
+                    << difference << "\n";
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------------------
+
+// usage: Benchmark [nodes...] [--filter text] [--min-time seconds] [--json results.json]
+// Graph benchmarks run for every node count, Floyd-Warshall kernels are checked against each other. The
+// kernels on fractional weights and the incremental all pairs maintenance are checked on every run, whatever
+// the filter.
+int main(int argc, char* argv[]) {
+  Suite suite;
+  std::vector<int> sizes;
+  std::string json;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--filter" && hasValue)
+      suite.filter = argv[++i];
+    else if (arg == "--min-time" && hasValue)
+      suite.minTime = std::stod(argv[++i]);
+    else if (arg == "--json" && hasValue)
+      json = argv[++i];
+    else if (!arg.starts_with("--"))
+      sizes.push_back(std::stoi(arg));
+    else {
+      std::cerr << "unknown option " << arg << "\n";
+      return 2;
+    }
+  }
+  if (sizes.empty())
+    sizes = { 256, 1024, 4096 };
+
+  std::cout << std::left << std::setw(56) << "benchmark" << std::right << std::setw(12) << "iterations"
+            << std::setw(16) << "ns/iteration" << std::setw(16) << "items/s" << "\n";
+
+  bool same = allPairsCheck();
+  same = kernelCheck() && same;
+  for (int size : sizes) {
+    graphBenchmarks(suite, size);
+    same = floydWarshallBenchmarks(suite, size) && same;
+  }
+  simulatorBenchmarks(suite);
+
+  if (!json.empty()) {
+    std::ofstream file(json);
+    suite.writeJson(file);
+    if (!file) {
+      std::cerr << "can not write " << json << "\n";
+      return 2;
+    }
+  }
+  return same ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+#include "HeadlessEngine.h"
+#include "MazeIO.h"
+#include "MazeGenerator.h"
+
+#include <string>
+
+using namespace sf;
+
+//--------------------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------------------
+
+// usage: Headless [--maze file] [--record trace] [maxSteps] [startX startY]
+// Without a start the car begins at 100,1000 in the built-in maze and in MazeGenerator::start() of a loaded one.
+int main(int argc, char* argv[]) {
+  Maze maze = defaultMaze();
+  Vector2f start(100, 1000);
+  std::string record;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "--maze" && i + 1 < argc) {
+      auto loaded = loadMaze(argv[++i]);
+      if (!loaded.has_value()) {
+        std::cerr << "can not read maze " << argv[i] << "\n";
+        return 2;
+      }
+      maze = std::move(loaded.value());
+      start = MazeGenerator::start(maze);
+    }
+    else if (std::string(argv[i]) == "--record" && i + 1 < argc)
+      record = argv[++i];
+    else
+      args.push_back(argv[i]);
+  }
+
+  long maxSteps = args.size() > 0 ? std::stol(args[0]) : 10'000'000;
+  if (args.size() > 2)
+    start = Vector2f(std::stof(args[1]), std::stof(args[2]));
+
+  HeadlessEngine engine(start, maze);
+  if (!record.empty())
+    engine.pathFinder.startRecording();
+  HeadlessResult result = engine.run(maxSteps);
+  if (!record.empty() && !engine.pathFinder.trace().save(record)) {
+    std::cerr << "can not write trace " << record << "\n";
+    return 2;
+  }
+
+  std::cout << (result.finished ? "exploration finished" : "exploration aborted") << "\n"
+            << "time:     " << result.time.count() << " s\n"
+            << "steps:    " << result.steps << "\n"
+            << "nodes:    " << result.nodes << "\n"
+            << "distance: " << result.distance << "\n"
+            << "sensor snapshot hit rate: " << engine.pathFinder.sensorSnapshot().hitRate() << "\n";
+
+  return result.finished ? 0 : 1;
+}
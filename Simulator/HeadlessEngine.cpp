@@ -0,0 +1,35 @@
+#include "HeadlessEngine.h"
+
+using namespace sf;
+
+//--------------------------------------------------------------------------------------------------------------
+// HeadlessEngine
+//--------------------------------------------------------------------------------------------------------------
+
+//------ HeadlessEngine ------
+HeadlessEngine::HeadlessEngine(Vector2f start, const Maze& maze) : sim(true, maze), pathFinder((Car*)sim.car.get()) {
+  ((Car*)sim.car.get())->move2(start);
+}
+
+//------ run ------
+HeadlessResult HeadlessEngine::run(long maxSteps) {
+  HeadlessResult result;
+  sim.bind(); // another engine on this thread may have run since
+  auto start = std::chrono::steady_clock::now();
+
+  while (result.steps < maxSteps) {
+    pathFinder.search();
+    ++result.steps;
+    if (pathFinder.state() == PathFinder::State::WAIT) {
+      result.finished = true;
+      break;
+    }
+  }
+
+  result.time = std::chrono::steady_clock::now() - start;
+  result.nodes = pathFinder.nodeCount();
+  result.finished = result.finished && result.nodes > 1; // done at the first junction: the start was no dead end
+  result.distance = ((Car*)sim.car.get())->getTravelledDistance();
+  result.collisions = pathFinder.collisions();
+  return result;
+}
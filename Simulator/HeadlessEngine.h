@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+
+#include "Simulator.h"
+#include "PathFindingSim.h"
+#include "PathFindingTrace.h"
+
+namespace sf {
+
+//--------------------------------------------------------------------------------------------------------------
+// HeadlessResult
+//--------------------------------------------------------------------------------------------------------------
+
+struct HeadlessResult {
+  std::chrono::duration<double> time{0}; // wall time spent in search()
+  long steps{0};                         // number of search() calls
+  std::size_t nodes{0};                  // junctions found
+  float distance{0};                     // distance travelled by the car
+  long collisions{0};                    // moves and turns blocked by a wall
+  bool finished{false};                  // exploration reached State::WAIT before maxSteps, past the first junction
+};
+
+//--------------------------------------------------------------------------------------------------------------
+// HeadlessEngine
+//--------------------------------------------------------------------------------------------------------------
+
+// Runs PathFinder against the car physics without a RenderWindow, as fast as the CPU allows.
+struct HeadlessEngine {
+  HeadlessEngine(Vector2f start = {100, 1000}, const Maze& maze = defaultMaze()); // default start: left corridor of the built-in maze
+
+  HeadlessResult run(long maxSteps); // engines on one thread may take turns, each run uses this engine's maze
+
+  Simulator sim;
+  PathFinderRecorder<PathFinderSim> pathFinder; // records only after startRecording()
+};
+
+} // end of namespace sf
@@ -0,0 +1,74 @@
+#include "MazeGenerator.h"
+#include "MazeIO.h"
+
+#include <filesystem>
+#include <string>
+#include <iostream>
+
+using namespace sf;
+
+//--------------------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------------------
+
+// usage: MazeGen <outDir> [--algorithm backtracker|prim|braided] [--size WxH] [--count n] [--seed s]
+//                [--braid 0.5] [--format text|binary]
+// Writes count mazes seeded seed, seed + 1, ... The car starts in MazeGenerator::start(), the bottom left cell
+// (200, height * 400 - 200), which Headless and BatchRunner use by default for loaded mazes.
+int main(int argc, char* argv[]) {
+  std::filesystem::path outDir;
+  MazeAlgorithm algorithm = MazeAlgorithm::BACKTRACKER;
+  std::string algorithmName = "backtracker";
+  int width = 10;
+  int height = 10;
+  int count = 1;
+  unsigned seed = 1;
+  float braid = 0.5f;
+  MazeFormat format = MazeFormat::BINARY;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--algorithm" && hasValue && parseMazeAlgorithm(argv[i + 1]).has_value()) {
+      algorithmName = argv[++i];
+      algorithm = parseMazeAlgorithm(algorithmName).value();
+    }
+    else if (arg == "--size" && hasValue) {
+      std::string size = argv[++i];
+      std::size_t x = size.find('x');
+      width = std::stoi(size.substr(0, x));
+      height = x == std::string::npos ? width : std::stoi(size.substr(x + 1));
+    }
+    else if (arg == "--count" && hasValue)
+      count = std::stoi(argv[++i]);
+    else if (arg == "--seed" && hasValue)
+      seed = (unsigned)std::stoul(argv[++i]);
+    else if (arg == "--braid" && hasValue)
+      braid = std::stof(argv[++i]);
+    else if (arg == "--format" && hasValue && parseMazeFormat(argv[i + 1]).has_value())
+      format = parseMazeFormat(argv[++i]).value();
+    else if (!arg.starts_with("--"))
+      outDir = arg;
+    else {
+      std::cerr << "unknown or invalid option " << arg << "\n";
+      return 2;
+    }
+  }
+  if (outDir.empty()) {
+    std::cerr << "usage: MazeGen <outDir> [--algorithm backtracker|prim|braided] [--size WxH] [--count n] [--seed s]"
+                 " [--braid 0.5] [--format text|binary]\n";
+    return 2;
+  }
+
+  std::filesystem::create_directories(outDir);
+  for (int i = 0; i < count; ++i) {
+    MazeGenerator generator(width, height, seed + i);
+    std::string name = algorithmName + "-" + std::to_string(width) + "x" + std::to_string(height) + "-" +
+      std::to_string(seed + i) + (format == MazeFormat::BINARY ? ".maze" : ".txt");
+    if (!saveMaze(outDir / name, generator.generate(algorithm, braid), format)) {
+      std::cerr << "can not write " << (outDir / name) << "\n";
+      return 1;
+    }
+  }
+  return 0;
+}
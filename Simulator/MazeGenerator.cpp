@@ -0,0 +1,237 @@
+#include "MazeGenerator.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace sf;
+
+//--------------------------------------------------------------------------------------------------------------
+// MazeGenerator
+//--------------------------------------------------------------------------------------------------------------
+
+//------ parseMazeAlgorithm ------
+std::optional<MazeAlgorithm> sf::parseMazeAlgorithm(const std::string& name) {
+  if (name == "backtracker")
+    return MazeAlgorithm::BACKTRACKER;
+  if (name == "prim")
+    return MazeAlgorithm::PRIM;
+  if (name == "braided")
+    return MazeAlgorithm::BRAIDED;
+  return std::nullopt;
+}
+
+//------ MazeGenerator ------
+MazeGenerator::MazeGenerator(int width, int height, unsigned seed)
+  : width_(std::max(width, 1)), height_(std::max(height, 1)), random_(seed) {}
+
+//------ start ------
+// Bottom left cell: the left border is the lowest x of the vertical walls, the bottom border the highest y of the
+// horizontal ones.
+Vector2f MazeGenerator::start(const Maze& maze) {
+  float left = std::numeric_limits<float>::infinity();
+  float bottom = -std::numeric_limits<float>::infinity();
+  for (auto& [center, horizontal] : maze) {
+    if (horizontal)
+      bottom = std::max(bottom, center.y);
+    else
+      left = std::min(left, center.x);
+  }
+  return Vector2f(left + cellSize / 2, bottom - cellSize / 2);
+}
+
+//------ generate ------
+Maze MazeGenerator::generate(MazeAlgorithm algorithm, float braid) {
+  horizontal_.assign((std::size_t)((height_ + 1) * width_), 1);
+  vertical_.assign((std::size_t)(height_ * (width_ + 1)), 1);
+
+  if (algorithm == MazeAlgorithm::PRIM)
+    prim();
+  else
+    backtracker();
+  if (algorithm == MazeAlgorithm::BRAIDED)
+    removeDeadEnds(braid);
+  carveStart();
+
+  return walls();
+}
+
+//------ backtracker ------
+void MazeGenerator::backtracker() {
+  std::vector<bool> visited((std::size_t)(width_ * height_), false);
+  std::vector<int> stack{ 0 };
+  visited[0] = true;
+
+  while (!stack.empty()) {
+    int cell = stack.back();
+    std::array<int, 4> next = neighbours(cell);
+
+    int unvisited[4];
+    int count = 0;
+    for (int direction = 0; direction < 4; ++direction) {
+      if (next[direction] >= 0 && !visited[next[direction]])
+        unvisited[count++] = direction;
+    }
+    if (count == 0) {
+      stack.pop_back();
+      continue;
+    }
+
+    int direction = unvisited[random(count)];
+    wall(cell, direction) = 0;
+    visited[next[direction]] = true;
+    stack.push_back(next[direction]);
+  }
+}
+
+//------ prim ------
+void MazeGenerator::prim() {
+  std::vector<bool> inMaze((std::size_t)(width_ * height_), false);
+  std::vector<bool> inFrontier((std::size_t)(width_ * height_), false);
+  std::vector<int> frontier;
+
+  auto add = [&](int cell) {
+    inMaze[cell] = true;
+    for (int next : neighbours(cell)) {
+      if (next >= 0 && !inMaze[next] && !inFrontier[next]) {
+        inFrontier[next] = true;
+        frontier.push_back(next);
+      }
+    }
+  };
+
+  add((int)random((std::uint32_t)(width_ * height_)));
+  while (!frontier.empty()) {
+    std::size_t i = random((std::uint32_t)frontier.size());
+    int cell = frontier[i];
+    frontier[i] = frontier.back();
+    frontier.pop_back();
+
+    std::array<int, 4> next = neighbours(cell);
+    int connected[4];
+    int count = 0;
+    for (int direction = 0; direction < 4; ++direction) {
+      if (next[direction] >= 0 && inMaze[next[direction]])
+        connected[count++] = direction;
+    }
+    wall(cell, connected[random(count)]) = 0;
+    add(cell);
+  }
+}
+
+//------ removeDeadEnds ------
+void MazeGenerator::removeDeadEnds(float braid) {
+  for (int cell = 0; cell < width_ * height_; ++cell) {
+    if (openSides(cell) != 1 || random(1000) >= (std::uint32_t)(braid * 1000))
+      continue;
+
+    // prefer opening into another dead end, that removes two at once
+    std::array<int, 4> next = neighbours(cell);
+    int candidates[4];
+    int count = 0;
+    for (int direction = 0; direction < 4; ++direction) {
+      if (next[direction] >= 0 && wall(cell, direction) && openSides(next[direction]) == 1)
+        candidates[count++] = direction;
+    }
+    if (count == 0) {
+      for (int direction = 0; direction < 4; ++direction) {
+        if (next[direction] >= 0 && wall(cell, direction))
+          candidates[count++] = direction;
+      }
+    }
+    if (count > 0)
+      wall(cell, candidates[random(count)]) = 0;
+  }
+}
+
+//------ carveStart ------
+// Opens the start cell to the north and closes it to the east. When that cuts the maze in two, a random wall
+// between the parts is opened again, so a perfect maze stays perfect.
+void MazeGenerator::carveStart() {
+  int start = (height_ - 1) * width_;
+  if (height_ < 2)
+    return; // no north to open
+  wall(start, 0) = 0;
+  if (width_ < 2 || wall(start, 1))
+    return;
+  wall(start, 1) = 1;
+
+  std::vector<bool> reached((std::size_t)(width_ * height_), false);
+  std::vector<int> stack{ start };
+  reached[start] = true;
+  while (!stack.empty()) {
+    int cell = stack.back();
+    stack.pop_back();
+    std::array<int, 4> next = neighbours(cell);
+    for (int direction = 0; direction < 4; ++direction) {
+      if (next[direction] >= 0 && !wall(cell, direction) && !reached[next[direction]]) {
+        reached[next[direction]] = true;
+        stack.push_back(next[direction]);
+      }
+    }
+  }
+
+  std::vector<std::pair<int, int>> bridges; // cell, direction
+  for (int cell = 0; cell < width_ * height_; ++cell) {
+    if (!reached[cell] || cell == start)
+      continue;
+    std::array<int, 4> next = neighbours(cell);
+    for (int direction = 0; direction < 4; ++direction) {
+      if (next[direction] >= 0 && !reached[next[direction]])
+        bridges.push_back({ cell, direction });
+    }
+  }
+  if (!bridges.empty()) {
+    auto [cell, direction] = bridges[random((std::uint32_t)bridges.size())];
+    wall(cell, direction) = 0;
+  }
+}
+
+//------ neighbours ------
+std::array<int, 4> MazeGenerator::neighbours(int cell) const {
+  int x = cell % width_;
+  int y = cell / width_;
+  return {
+    y > 0 ? cell - width_ : -1,
+    x + 1 < width_ ? cell + 1 : -1,
+    y + 1 < height_ ? cell + width_ : -1,
+    x > 0 ? cell - 1 : -1,
+  };
+}
+
+//------ wall ------
+std::uint8_t& MazeGenerator::wall(int cell, int direction) {
+  int x = cell % width_;
+  int y = cell / width_;
+  switch (direction) {
+    case 0: return horizontal_[y * width_ + x];
+    case 1: return vertical_[y * (width_ + 1) + x + 1];
+    case 2: return horizontal_[(y + 1) * width_ + x];
+    default: return vertical_[y * (width_ + 1) + x];
+  }
+}
+
+//------ openSides ------
+int MazeGenerator::openSides(int cell) {
+  int open = 0;
+  for (int direction = 0; direction < 4; ++direction)
+    open += wall(cell, direction) == 0;
+  return open;
+}
+
+//------ walls ------
+Maze MazeGenerator::walls() const {
+  Maze maze;
+  for (int y = 0; y <= height_; ++y) {
+    for (int x = 0; x < width_; ++x) {
+      if (horizontal_[y * width_ + x])
+        maze.push_back({ Vector2f((x + 0.5f) * cellSize, y * cellSize), true });
+    }
+  }
+  for (int y = 0; y < height_; ++y) {
+    for (int x = 0; x <= width_; ++x) {
+      if (vertical_[y * (width_ + 1) + x])
+        maze.push_back({ Vector2f(x * cellSize, (y + 0.5f) * cellSize), false });
+    }
+  }
+  return maze;
+}
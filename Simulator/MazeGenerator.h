@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Simulator.h"
+
+namespace sf {
+
+//--------------------------------------------------------------------------------------------------------------
+// MazeGenerator
+//--------------------------------------------------------------------------------------------------------------
+
+enum class MazeAlgorithm {
+  BACKTRACKER, // recursive backtracker, long winding corridors
+  PRIM,        // randomized Prim, many short dead ends
+  BRAIDED,     // backtracker with part of the dead ends opened up, so the maze has loops
+};
+
+std::optional<MazeAlgorithm> parseMazeAlgorithm(const std::string& name); // "backtracker", "prim" or "braided"
+
+// Perfect (or braided) labyrinths of width x height cells on the grid the Wall constructor assumes: cells are
+// cellSize units wide, cell (x, y) spans [x * cellSize, (x + 1) * cellSize) and every wall is one cell long.
+// The same seed gives the same maze on every platform. The bottom left cell is a dead end open to the north only,
+// the shape PathFinder expects at its start: it takes the corridor width from there and finds the first junction
+// ahead.
+struct MazeGenerator {
+  static constexpr float cellSize = 400;
+
+  MazeGenerator(int width, int height, unsigned seed);
+
+  Maze generate(MazeAlgorithm algorithm, float braid = 0.5f); // braid: share of dead ends opened by BRAIDED
+
+  static Vector2f cellCenter(int x, int y) { return Vector2f((x + 0.5f) * cellSize, (y + 0.5f) * cellSize); }
+  Vector2f start() const { return cellCenter(0, height_ - 1); } // where the car starts, looking north
+  static Vector2f start(const Maze& maze);                        // the same for a generated maze loaded from a file
+
+private:
+  void backtracker();
+  void prim();
+  void removeDeadEnds(float braid);
+  void carveStart();
+
+  // neighbours of a cell in the order north, east, south, west, -1 outside the maze
+  std::array<int, 4> neighbours(int cell) const;
+  std::uint8_t& wall(int cell, int direction); // wall on the given side of a cell, 1 if present
+  int openSides(int cell);
+  std::uint32_t random(std::uint32_t n) { return (std::uint32_t)(random_() % n); } // mt19937 output is portable
+
+  Maze walls() const;
+
+  int width_;
+  int height_;
+  std::mt19937 random_;
+  std::vector<std::uint8_t> horizontal_; // (height + 1) rows of width walls, row y lies above cell row y
+  std::vector<std::uint8_t> vertical_;   // height rows of (width + 1) walls, column x lies left of cell column x
+};
+
+} // end of namespace sf
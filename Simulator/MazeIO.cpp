@@ -0,0 +1,160 @@
+#include "MazeIO.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace sf;
+
+//--------------------------------------------------------------------------------------------------------------
+// Maze files
+//--------------------------------------------------------------------------------------------------------------
+
+//------ loadMaze ------
+std::optional<Maze> sf::loadMaze(const std::filesystem::path& path) {
+  char magic[4] = {};
+  {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+      return std::nullopt;
+    file.read(magic, sizeof(magic));
+  }
+
+  if (std::memcmp(magic, MazeFileHeader::magicBytes, sizeof(magic)) == 0) {
+    MappedMaze mapped(path);
+    if (!mapped.valid())
+      return std::nullopt;
+    Maze maze;
+    maze.reserve(mapped.walls().size());
+    for (const MazeFileWall& wall : mapped.walls())
+      maze.push_back({ Vector2f(wall.x, wall.y), wall.horizontal != 0 });
+    return maze;
+  }
+
+  std::ifstream file(path);
+  Maze maze;
+  std::string line;
+  bool content = false;
+  while (std::getline(file, line)) {
+    if (line.starts_with('#') || line.find_first_not_of(" \t\r") == std::string::npos)
+      continue;
+    content = true;
+    std::replace_if(line.begin(), line.end(), [](char c) { return c == '{' || c == '}' || c == ','; }, ' ');
+    std::istringstream fields(line);
+    float x, y;
+    int horizontal;
+    if (fields >> x >> y >> horizontal)
+      maze.push_back({ Vector2f(x, y), horizontal != 0 });
+  }
+  if (maze.empty() && content)
+    return std::nullopt; // not a maze file
+  return maze;
+}
+
+//------ saveMaze ------
+bool sf::saveMaze(const std::filesystem::path& path, const Maze& maze, MazeFormat format) {
+  if (format == MazeFormat::TEXT) {
+    std::ofstream file(path);
+    for (auto& [center, horizontal] : maze)
+      file << "{{ " << center.x << ", " << center.y << " }, " << horizontal << " },\n";
+    return (bool)file;
+  }
+
+  MazeFileHeader header{};
+  std::memcpy(header.magic, MazeFileHeader::magicBytes, sizeof(header.magic));
+  header.version = MazeFileHeader::currentVersion;
+  header.wallCount = (std::uint32_t)maze.size();
+
+  std::vector<MazeFileWall> walls;
+  walls.reserve(maze.size());
+  for (auto& [center, horizontal] : maze)
+    walls.push_back({ center.x, center.y, horizontal ? 1u : 0u });
+
+  std::ofstream file(path, std::ios::binary);
+  file.write((const char*)&header, sizeof(header));
+  file.write((const char*)walls.data(), (std::streamsize)(walls.size() * sizeof(MazeFileWall)));
+  return (bool)file;
+}
+
+//------ parseMazeFormat ------
+std::optional<MazeFormat> sf::parseMazeFormat(const std::string& name) {
+  if (name == "text")
+    return MazeFormat::TEXT;
+  if (name == "binary")
+    return MazeFormat::BINARY;
+  return std::nullopt;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// MappedMaze
+//--------------------------------------------------------------------------------------------------------------
+
+//------ MappedMaze ------
+MappedMaze::MappedMaze(const std::filesystem::path& path) {
+#ifdef _WIN32
+  file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_ == INVALID_HANDLE_VALUE) {
+    file_ = nullptr;
+    return;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+    return;
+  mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping_)
+    return;
+  data_ = (const std::byte*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+  size_ = data_ ? (std::size_t)size.QuadPart : 0;
+#else
+  int file = open(path.c_str(), O_RDONLY);
+  if (file < 0)
+    return;
+  struct stat status;
+  if (fstat(file, &status) == 0 && status.st_size > 0) {
+    void* data = mmap(nullptr, (std::size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (data != MAP_FAILED) {
+      data_ = (const std::byte*)data;
+      size_ = (std::size_t)status.st_size;
+    }
+  }
+  close(file); // the mapping stays valid
+#endif
+
+  if (size_ < sizeof(MazeFileHeader))
+    return;
+  MazeFileHeader header;
+  std::memcpy(&header, data_, sizeof(header));
+  if (std::memcmp(header.magic, MazeFileHeader::magicBytes, sizeof(header.magic)) != 0 ||
+      header.version != MazeFileHeader::currentVersion ||
+      size_ < sizeof(MazeFileHeader) + (std::size_t)header.wallCount * sizeof(MazeFileWall))
+    return;
+  walls_ = std::span<const MazeFileWall>((const MazeFileWall*)(data_ + sizeof(MazeFileHeader)), header.wallCount);
+}
+
+//------ ~MappedMaze ------
+MappedMaze::~MappedMaze() {
+#ifdef _WIN32
+  if (data_)
+    UnmapViewOfFile(data_);
+  if (mapping_)
+    CloseHandle(mapping_);
+  if (file_)
+    CloseHandle(file_);
+#else
+  if (data_)
+    munmap((void*)data_, size_);
+#endif
+}
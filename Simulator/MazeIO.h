@@ -0,0 +1,79 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+
+#include "Simulator.h"
+
+namespace sf {
+
+//--------------------------------------------------------------------------------------------------------------
+// Maze files
+//--------------------------------------------------------------------------------------------------------------
+
+// TEXT:   one wall per line as the old F2 dump wrote them, {{ x, y }, horizontal }, lines starting with # are
+//         comments.
+// BINARY: MazeFileHeader followed by wallCount MazeFileWall records in host byte order, no padding, so a mapped
+//         file can be used in place. Only little endian hosts are supported, which keeps the files portable
+//         between them.
+enum class MazeFormat {
+  TEXT,
+  BINARY,
+};
+
+struct MazeFileHeader {
+  static constexpr char magicBytes[4] = { 'M', 'A', 'Z', 'E' };
+  static constexpr std::uint32_t currentVersion = 1;
+
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t wallCount;
+  std::uint32_t reserved; // 0
+};
+
+struct MazeFileWall {
+  float x; // center
+  float y;
+  std::uint32_t horizontal; // 0 or 1
+};
+
+static_assert(sizeof(MazeFileHeader) == 16 && sizeof(MazeFileWall) == 12);
+static_assert(std::endian::native == std::endian::little, "binary maze files are little endian");
+
+// Reads either format, the binary one is recognized by its magic bytes. nullopt if the file can not be read, is a
+// binary maze of another version or is a text file with content but not a single wall in it.
+std::optional<Maze> loadMaze(const std::filesystem::path& path);
+bool saveMaze(const std::filesystem::path& path, const Maze& maze, MazeFormat format);
+
+std::optional<MazeFormat> parseMazeFormat(const std::string& name); // "text" or "binary"
+
+//--------------------------------------------------------------------------------------------------------------
+// MappedMaze
+//--------------------------------------------------------------------------------------------------------------
+
+// Binary maze file mapped read only into memory, walls() points straight into the mapping.
+struct MappedMaze {
+  explicit MappedMaze(const std::filesystem::path& path);
+  ~MappedMaze();
+
+  MappedMaze(const MappedMaze&) = delete;
+  MappedMaze& operator = (const MappedMaze&) = delete;
+
+  bool valid() const { return walls_.data() != nullptr; } // mapped, magic, version and size check out
+  std::span<const MazeFileWall> walls() const { return walls_; }
+
+private:
+  const std::byte* data_{nullptr};
+  std::size_t size_{0};
+  std::span<const MazeFileWall> walls_;
+#ifdef _WIN32
+  void* file_{nullptr};
+  void* mapping_{nullptr};
+#endif
+};
+
+} // end of namespace sf
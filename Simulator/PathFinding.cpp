@@ -1,6 +1,13 @@
 #include "PathFinding.h"
+#include "Profiler.h"
 
 void PathFinder::search() {
+  PROFILE_SCOPE("PathFinder::search");
+  // Pos::tolerance_ is per thread, agents taking turns on one thread each bring their own
+  if (currentState_ != State::BEGIN)
+    Pos::setTolerance(wallDist_ / 2);
+
+  State previousState = currentState_;
   switch (currentState_) {
     case State::BEGIN:
       initialize();
@@ -22,12 +29,15 @@ void PathFinder::search() {
       break;
     case State::WAIT:
       wait();
-      return;
+      break;
   }
+  if (currentState_ != previousState)
+    emit({ .type = Event::Type::STATE_CHANGED, .state = currentState_ });
 }
 
 //------ initialize ------
 void PathFinder::initialize() {
+  PROFILE_SCOPE("BEGIN");
   wallDist_ = (measureDistance(TOPLEFT) + measureDistance(TOPRIGHT));
   wallDist_ *= 1; // deduct size of car
   // also positionCorrection
@@ -38,6 +48,7 @@ void PathFinder::initialize() {
 
 //------ moveToJunction ------
 void PathFinder::moveToJunction() {
+  PROFILE_SCOPE("MOVE_TO_JUNCTION");
   if (!freePlay_) {
     if (nodeStack_.empty()) {
       if (currentNode_.x == 0 && currentNode_.y != 0)
@@ -73,9 +84,7 @@ void PathFinder::moveToJunction() {
 
 //------ moveOntoJunction ------
 void PathFinder::moveOntoJunction() {
-  static bool begin = true;
-
-  static float travelDistStart = 0;
+  PROFILE_SCOPE("MOVE_ONTO_JUNCTION");
 
   if (move_ != 0) {
     move_ -= move();
@@ -83,13 +92,13 @@ void PathFinder::moveOntoJunction() {
       move_ = 0;
   }
 
-  if (begin) {
-    travelDistStart = getTravelDist();
-    begin = false;
+  if (ontoJunctionBegin_) {
+    ontoJunctionStart_ = getTravelDist();
+    ontoJunctionBegin_ = false;
   }
 
-  if (move_ == 0 && getTravelDist() - travelDistStart < (wallDist_ / 3.7f)) {
-    if (measureDistance(TOPRIGHT) < wallDist_ * 1.5 && measureDistance(TOPLEFT) < wallDist_ * 1.5) {
+  if (move_ == 0 && getTravelDist() - ontoJunctionStart_ < (wallDist_ / parameters_.junctionOffset)) {
+    if (measureDistance(TOPRIGHT) < wallDist_ * parameters_.wallThreshold && measureDistance(TOPLEFT) < wallDist_ * parameters_.wallThreshold) {
       turn(currentOrientation_.turnBack());
       move_ = (wallDist_ / 8);
       return;
@@ -97,14 +106,14 @@ void PathFinder::moveOntoJunction() {
     move();
   }
   else {
-    if (measureDistance(BOTTOMLEFT) < wallDist_ * 1.5 && measureDistance(BOTTOMRIGHT) < wallDist_ * 1.5)
-      begin = true;
+    if (measureDistance(BOTTOMLEFT) < wallDist_ * parameters_.wallThreshold && measureDistance(BOTTOMRIGHT) < wallDist_ * parameters_.wallThreshold)
+      ontoJunctionBegin_ = true;
     else {
       if (freePlay_ && !goal_.has_value()) {
         currentState_ = State::WAIT;
         return;
       }
-      begin = true;
+      ontoJunctionBegin_ = true;
       currentState_ = State::HANDLE_JUNCTION;
     }
   }
@@ -112,8 +121,7 @@ void PathFinder::moveOntoJunction() {
 
 //------ handleJunction ------
 void PathFinder::handleJunction() {
-  static std::shared_ptr<Node> prevNode = nullptr;
-
+  PROFILE_SCOPE("HANDLE_JUNCTION");
   if (freePlay_) {
     if (!adjacencyMatrix_.contains(currentNode_)) {
       currentState_ = State::MOVE_ONTO_JUNCTION;
@@ -132,30 +140,28 @@ void PathFinder::handleJunction() {
 
   adjacencyMatrix_.pushNode(currentNode_);
 
-  auto pNodeIt = std::ranges::find_if(visitedNodes_, [this](std::shared_ptr<Node> n) { return currentNode_ == *n; });
-  std::shared_ptr<Node> pCurrentNode;
-  if (pNodeIt == visitedNodes_.end()) {
-    auto node = std::make_shared<Node>(currentNode_);
-    nodeStack_.push(node);
-    visitedNodes_.insert(node);
-    pCurrentNode = nodeStack_.top();
+  NodeId currentId = (NodeId)adjacencyMatrix_.find(currentNode_).value();
+  if (currentId == nodes_.size()) {
+    nodeStack_.push(nodes_.push(currentNode_));
+    uploadNode(currentNode_);
+    emit({ .type = Event::Type::NODE_CREATED, .node = currentId });
   }
-  else
-    pCurrentNode = *pNodeIt;
-
-  if (prevNode) {
-    if (prevNode != pCurrentNode)
-      adjacencyMatrix_.addDistance(*prevNode, currentNode_, getTravelDist());
-    prevNode->junction.erase({ currentOrientation_, false});
-    prevNode->junction.insert({ currentOrientation_, true });
-    pCurrentNode->junction.erase({ currentOrientation_.turnBack(), false});
-    pCurrentNode->junction.insert({ currentOrientation_.turnBack(), true });
+  Node* pCurrentNode = &nodes_[currentId];
+
+  if (prevNode_ != NodeArena::none) {
+    if (prevNode_ != currentId) {
+      float distance = getTravelDist();
+      adjacencyMatrix_.addDistance(nodes_[prevNode_], currentNode_, distance);
+      emit({ .type = Event::Type::EDGE_ADDED, .node = prevNode_, .to = currentId, .distance = distance });
+    }
+    nodes_[prevNode_].junction.mark(currentOrientation_, true);
+    pCurrentNode->junction.mark(currentOrientation_.turnBack(), true);
   }
   else
     begin_ = false;
   updateTravelDist();
 
-  prevNode = pCurrentNode;
+  prevNode_ = currentId;
 
   bool unvisitedRight = false;
   bool unvisitedLeft = false;
@@ -163,31 +169,16 @@ void PathFinder::handleJunction() {
   bool newNodeCreated = false;
 
   if (!detectWallRight()) {
-    auto pIt = pCurrentNode->junction.find({ currentOrientation_.turnRight(), false });
-    if (pIt == pCurrentNode->junction.end()) {
-      pCurrentNode->junction.insert({ currentOrientation_.turnRight(), false });
-      unvisitedRight = true;
-    }
-    else
-      unvisitedRight = !std::get<1>(*pIt);
+    pCurrentNode->junction.mark(currentOrientation_.turnRight(), false);
+    unvisitedRight = !pCurrentNode->junction.visited(currentOrientation_.turnRight());
   }
   if (!detectWallLeft()) {
-    auto pIt = pCurrentNode->junction.find({ currentOrientation_.turnLeft(), false });
-    if (pIt == pCurrentNode->junction.end()) {
-      pCurrentNode->junction.insert({ currentOrientation_.turnLeft(), false });
-      unvisitedLeft = true;
-    }
-    else
-      unvisitedLeft = !std::get<1>(*pIt);
+    pCurrentNode->junction.mark(currentOrientation_.turnLeft(), false);
+    unvisitedLeft = !pCurrentNode->junction.visited(currentOrientation_.turnLeft());
   }
   if (!detectWall(TOP)) {
-    auto pIt = pCurrentNode->junction.find({ currentOrientation_, false });
-    if (pIt == pCurrentNode->junction.end()) {
-      pCurrentNode->junction.insert({ currentOrientation_, false });
-      unvisitedFront = true;
-    }
-    else
-      unvisitedFront = !std::get<1>(*pIt);
+    pCurrentNode->junction.mark(currentOrientation_, false);
+    unvisitedFront = !pCurrentNode->junction.visited(currentOrientation_);
   }
 
   // decides which path to take
@@ -235,6 +226,7 @@ void PathFinder::handleJunction() {
 
 //------ handleUnvisitedRight ------
 void PathFinder::handleOutOfJunctionRight() {
+  PROFILE_SCOPE("HANDLE_OUT_OF_JUNCTION_RIGHT");
   if (detectWall(BOTTOMRIGHT))
     currentState_ = State::MOVE_TO_JUNCTION;
   move();
@@ -242,6 +234,7 @@ void PathFinder::handleOutOfJunctionRight() {
 
 //------ handleUnvisitedLeft ------
 void PathFinder::handleOutOfJunctionLeft() {
+  PROFILE_SCOPE("HANDLE_OUT_OF_JUNCTION_LEFT");
   if (detectWall(BOTTOMLEFT))
     currentState_ = State::MOVE_TO_JUNCTION;
   move();
@@ -249,18 +242,13 @@ void PathFinder::handleOutOfJunctionLeft() {
 
 //------ backtrack ------
 void PathFinder::backtrack() {
-  static std::vector<Node> backtrackStack;
    if (nodeStack_.empty()) {
     currentState_ = State::WAIT;
     return;
   }
 
-  if (backtrackStack.empty()) {
-    auto pNodeIt = std::ranges::find_if(visitedNodes_, [this](std::shared_ptr<Node> n) { return currentNode_ == *n; });
-    std::shared_ptr<Node> pCurrentNode = *pNodeIt;
-
-    adjacencyMatrix_.floydWarshall();
-    if (*nodeStack_.top() == currentNode_)
+  if (backtrackPath_.empty()) {
+    if (nodes_[nodeStack_.top()] == currentNode_)
       nodeStack_.pop();
 
     if (nodeStack_.empty()) {
@@ -268,11 +256,11 @@ void PathFinder::backtrack() {
       return;
     }
 
-    backtrackStack = adjacencyMatrix_.goTo(currentNode_, *nodeStack_.top());
+    backtrackPath_ = adjacencyMatrix_.goTo(currentNode_, nodes_[nodeStack_.top()]);
   }
-  if (!backtrackStack.empty()) {
-    goToNeighbor(backtrackStack[0]);
-    backtrackStack.erase(backtrackStack.begin());
+  if (!backtrackPath_.empty()) {
+    goToNeighbor(backtrackPath_[0]);
+    backtrackPath_.erase(backtrackPath_.begin());
   }
   else {
     goal_ = std::nullopt;
@@ -285,8 +273,8 @@ void PathFinder::backtrack() {
 
 //------ wait ------
 void PathFinder::wait() {
-  if (!freePlay_)
-    adjacencyMatrix_.floydWarshall();
+  PROFILE_SCOPE("WAIT");
+  adjacencyMatrix_.maintainAllPairs(true); // free play goals can be any node, no-op while the map is unchanged
   freePlay_ = true;
   backtrack_ = false;
   goal_ = setGoal();
@@ -340,19 +328,17 @@ bool PathFinder::turn(Orientation orientation) {
 
 //------ setGoal ------
 std::optional<Node> PathFinder::setGoal(const std::optional<Node>& goal) {
-  static std::optional<Node> _goal = std::nullopt;
   std::optional<Node> ret = std::nullopt;
   if (!goal.has_value()) {
-    ret = _goal;
-    _goal = std::nullopt;
+    ret = requestedGoal_;
+    requestedGoal_ = std::nullopt;
   }
-  else if (!_goal.has_value())
-    _goal = goal;
+  else if (!requestedGoal_.has_value())
+    requestedGoal_ = goal;
   return ret;
 }
 
 //------ detectWall ------
 bool PathFinder::detectWall(SensorDirection direction) {
-  auto x = measureDistance(direction);
-  return measureDistance(direction) < wallDist_ * 1.5;
+  return measureDistance(direction) < wallDist_ * parameters_.wallThreshold;
 }
\ No newline at end of file
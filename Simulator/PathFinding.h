@@ -6,15 +6,40 @@
 #include <cassert>
 #include <unordered_set>
 #include <algorithm>
+#include <functional>
 #include "AdjacencyMatrix.h"
 #include "Sensor.h"
 
 //--------------------------------------------------------------------------------------------------------------
-// PathFinder
+// NodeArena
 //--------------------------------------------------------------------------------------------------------------
 
-using NodeSet = std::set<std::shared_ptr<Node>, decltype([](const std::shared_ptr<Node>& l, const std::shared_ptr<Node>& r)
-    { return l.get() < r.get(); })>;
+// Owns every visited Node. Ids are handed out in creation order and stay valid for the arena's lifetime,
+// references only until the next push().
+struct NodeArena {
+  static constexpr NodeId none = std::numeric_limits<NodeId>::max();
+
+  NodeId push(const Node& node) {
+    nodes_.push_back(node);
+    return (NodeId)(nodes_.size() - 1);
+  }
+
+  Node& operator [] (NodeId id) { return nodes_[id]; }
+  const Node& operator [] (NodeId id) const { return nodes_[id]; }
+
+  std::size_t size() const { return nodes_.size(); }
+  bool empty() const { return nodes_.empty(); }
+
+  auto begin() const { return nodes_.begin(); }
+  auto end() const { return nodes_.end(); }
+
+private:
+  std::vector<Node> nodes_;
+};
+
+//--------------------------------------------------------------------------------------------------------------
+// PathFinder
+//--------------------------------------------------------------------------------------------------------------
 
 struct PathFinder {
   enum class State {
@@ -29,13 +54,19 @@ struct PathFinder {
     WAIT,
   };
 
+  // tuning knobs, the defaults are the hand tuned values
+  struct Parameters {
+    float wallThreshold{1.5f};  // a wall is detected below wallDist_ * wallThreshold
+    float junctionOffset{3.7f}; // moves wallDist_ / junctionOffset onto a junction before handling it
+  };
+
 
   PathFinder() : currentNode_(Node(0,0)), currentOrientation_(NORTH) {}
 
   //------------------------------------------------------------------------------------------------------------
   // TODO implement
 
-  virtual float move() = 0; // moves front a fixed distance, gets regularely called
+  virtual float move() = 0; // moves front a fixed distance, gets regularely called, returns the distance moved
   virtual bool turn90RightImpl() = 0; // turns Right exactly 90 degrees without covering distance
   virtual bool turn90LeftImpl() = 0; // turns LEFT exactly 90 degrees without covering distance
   virtual float measureDistance(SensorDirection direction) = 0; // measures distance of each Sensor
@@ -58,29 +89,40 @@ struct PathFinder {
   bool createNode();
   std::optional<Node> setGoal(const std::optional<Node>& node = std::nullopt);
   void search();
-  std::shared_ptr<Node> newNode() {
-    // returns Node if a new Node was found
-    static NodeSet nodes = visitedNodes_;
-    if (visitedNodes_.size() > nodes.size()) {
-      NodeSet ret;
-      std::set_difference(visitedNodes_.begin(), visitedNodes_.end(),nodes.begin(), nodes.end(), std::inserter(ret, ret.begin()));
-      nodes = visitedNodes_;
-      return *ret.begin();
-    }
-    return nullptr;
-  }
+  State state() const                                   { return currentState_; }
+  const Parameters& parameters() const                  { return parameters_; }
+  void setParameters(const Parameters& parameters)      { parameters_ = parameters; }
+  std::size_t nodeCount() const                         { return nodes_.size(); }
+  const Node& node(NodeId id) const                     { return nodes_[id]; }
+
+  // Raised while search() runs, in the order things happen.
+  struct Event {
+    enum class Type {
+      NODE_CREATED,  // node
+      EDGE_ADDED,    // node -> to, distance
+      STATE_CHANGED, // state
+    };
+
+    Type type;
+    NodeId node{NodeArena::none};
+    NodeId to{NodeArena::none};
+    float distance{0};
+    State state{State::BEGIN};
+  };
+  void setListener(std::function<void(const Event&)> listener) { listener_ = std::move(listener); }
 
 
 protected:
   AdjacencyMatrix adjacencyMatrix_;
 
   Node currentNode_;
-  std::stack<std::shared_ptr<Node>> nodeStack_;
-  NodeSet visitedNodes_;
+  std::stack<NodeId> nodeStack_;
+  NodeArena nodes_; // visited nodes, ids match the indices of adjacencyMatrix_
   Orientation currentOrientation_;
 
   float travelledDist_{0};
   float wallDist_{0};
+  Parameters parameters_;
 
 private:
   State currentState_ = State::BEGIN;
@@ -94,12 +136,19 @@ private:
   void backtrack();
   void wait();
   void goToNeighbor(const Node& goal);
+  void emit(const Event& event)                         { if (listener_) listener_(event); }
 
   bool backtrack_ = false;
   bool begin_ = true;
   bool freePlay_ = false;
   std::optional<Node> goal_;
+  std::optional<Node> requestedGoal_; // set by setGoal(), taken in wait()
   float move_ = 0;
+  bool ontoJunctionBegin_ = true;     // moveOntoJunction() starts measuring travelled distance
+  float ontoJunctionStart_ = 0;
+  NodeId prevNode_ = NodeArena::none; // junction handled last
+  std::vector<Node> backtrackPath_;
+  std::function<void(const Event&)> listener_;
 };
 
 
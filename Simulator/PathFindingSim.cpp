@@ -23,33 +23,54 @@ PathFinderSim::PathFinderSim(Car* pCar)
 
 //------ move ------
 float PathFinderSim::move() {
-  move(0.3f);
-  return 0.3f;
+  return move(step_);
 }
 
 //------ move ------
-void PathFinderSim::move(float dist) {
-  if (!((Object*)pCar_)->backTrackedMove(pCar_->front * dist))
-    return;
+float PathFinderSim::move(float dist) {
+  float moved = ((Object*)pCar_)->sweptMove(pCar_->front * dist);
+  if (moved < dist)
+    ++collisions_;
 
-  currentNode_.x += pCar_->front.x * dist;
-  currentNode_.y += pCar_->front.y * dist;
+  currentNode_.x += pCar_->front.x * moved;
+  currentNode_.y += pCar_->front.y * moved;
+  return moved;
 }
 
 //------ turn90RightImpl ------
 bool PathFinderSim::turn90RightImpl() {
-  if (!((Object*)pCar_)->backTrackedTurn90(true))
+  if (!((Object*)pCar_)->backTrackedTurn90(true)) {
+    ++collisions_;
     return false;
+  }
   return true;
 }
 
 //------ turn90LeftImpl ------
 bool PathFinderSim::turn90LeftImpl() {
-  if (!((Object*)pCar_)->backTrackedTurn90(false))
+  if (!((Object*)pCar_)->backTrackedTurn90(false)) {
+    ++collisions_;
     return false;
+  }
   return true;
 }
 
+//------ measureDistance ------
+float PathFinderSim::measureDistance(SensorDirection direction) {
+  if (snapshotPose_ != pCar_->poseVersion() || snapshotWalls_ != pWallGrid->version()) {
+    snapshot_.invalidate();
+    snapshotPose_ = pCar_->poseVersion();
+    snapshotWalls_ = pWallGrid->version();
+  }
+  return snapshot_.get(direction, [this](SensorDirection direction) { return sensors_[direction]->measureDistance(); });
+}
+
+//------ sensorReadings ------
+std::array<float, 5> PathFinderSim::sensorReadings() {
+  return { measureDistance(TOPRIGHT), measureDistance(TOPLEFT), measureDistance(BOTTOMRIGHT),
+    measureDistance(BOTTOMLEFT), measureDistance(TOP) };
+}
+
 //------ uploadNode ------
 void PathFinderSim::uploadNode(const Node& node) {
 
@@ -10,21 +10,35 @@ struct PathFinderSim : public PathFinder {
   PathFinderSim(Car* car);
 
   float move() override;
-  void move(float dist);
+  float move(float dist); // returns the distance moved, less than dist when a wall is in the way
 
 
   bool turn90RightImpl() override;
   bool turn90LeftImpl() override;
-  float measureDistance(SensorDirection direction) override { return sensors_[direction]->measureDistance(); }
+  float measureDistance(SensorDirection direction) override;
+  std::array<float, 5> sensorReadings(); // all five readings, taken from the snapshot where possible
 
   float travelledDist() override { return pCar_->getTravelledDistance(); }
 
-  bool touchWallTop() override { return sensors_[SensorDirection::TOP]->measureDistance() < 20.0f; }
+  bool touchWallTop() override { return measureDistance(SensorDirection::TOP) < 20.0f; }
   void uploadNode(const Node& node) override;
 
+  const SensorSnapshot& sensorSnapshot() const { return snapshot_; }
+
+  void setStep(float step)                      { step_ = step; } // distance covered by move()
+  float step() const                            { return step_; }
+  long collisions() const                       { return collisions_; } // moves and turns blocked by a wall
+
 private:
   std::array<const DistanceSensor*, 5> sensors_;
   Car* pCar_;
+
+  SensorSnapshot snapshot_;
+  unsigned snapshotPose_{0};  // Car::poseVersion() the snapshot was taken at
+  unsigned snapshotWalls_{0}; // WallGrid::version() of the walls it measured
+
+  float step_{0.3f};
+  long collisions_{0};
 };
 
 } // end of namespace sf
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "PathFindingTrace.h"
+
+#include <cstring>
+#include <fstream>
+
+//--------------------------------------------------------------------------------------------------------------
+// PathFinderTrace
+//--------------------------------------------------------------------------------------------------------------
+
+//------ save ------
+bool PathFinderTrace::save(const std::filesystem::path& path) const {
+  TraceFileHeader header{};
+  std::memcpy(header.magic, TraceFileHeader::magicBytes, sizeof(header.magic));
+  header.version = TraceFileHeader::currentVersion;
+  header.wallThreshold = parameters.wallThreshold;
+  header.junctionOffset = parameters.junctionOffset;
+  header.entryCount = (std::uint32_t)entries.size();
+
+  std::vector<char> data(entries.size() * TraceFileHeader::entrySize);
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    data[i * TraceFileHeader::entrySize] = (char)((std::uint8_t)entries[i].call | entries[i].argument << 4);
+    std::memcpy(&data[i * TraceFileHeader::entrySize + 1], &entries[i].value, sizeof(float));
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  file.write((const char*)&header, sizeof(header));
+  file.write(data.data(), (std::streamsize)data.size());
+  return (bool)file;
+}
+
+//------ load ------
+std::optional<PathFinderTrace> PathFinderTrace::load(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  TraceFileHeader header;
+  if (!file.read((char*)&header, sizeof(header)) ||
+      std::memcmp(header.magic, TraceFileHeader::magicBytes, sizeof(header.magic)) != 0 ||
+      header.version != TraceFileHeader::currentVersion)
+    return std::nullopt;
+
+  std::vector<char> data((std::size_t)header.entryCount * TraceFileHeader::entrySize);
+  if (!file.read(data.data(), (std::streamsize)data.size()))
+    return std::nullopt;
+
+  PathFinderTrace trace;
+  trace.parameters = { .wallThreshold = header.wallThreshold, .junctionOffset = header.junctionOffset };
+  trace.entries.resize(header.entryCount);
+  for (std::size_t i = 0; i < trace.entries.size(); ++i) {
+    std::uint8_t code = (std::uint8_t)data[i * TraceFileHeader::entrySize];
+    trace.entries[i].call = (Call)(code & 0x0f);
+    trace.entries[i].argument = code >> 4;
+    std::memcpy(&trace.entries[i].value, &data[i * TraceFileHeader::entrySize + 1], sizeof(float));
+  }
+  return trace;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// PathFinderReplay
+//--------------------------------------------------------------------------------------------------------------
+
+//------ PathFinderReplay ------
+PathFinderReplay::PathFinderReplay(PathFinderTrace trace) : trace_(std::move(trace)) {
+  setParameters(trace_.parameters);
+}
+
+//------ move ------
+float PathFinderReplay::move() {
+  float dist = next(PathFinderTrace::Call::MOVE, 0);
+  if (!finished()) {
+    float x = next(PathFinderTrace::Call::POSITION, 0);
+    float y = next(PathFinderTrace::Call::POSITION, 1);
+    if (!divergence_.has_value()) {
+      currentNode_.x = x;
+      currentNode_.y = y;
+    }
+  }
+  return dist;
+}
+
+//------ next ------
+float PathFinderReplay::next(PathFinderTrace::Call call, std::uint8_t argument) {
+  if (finished())
+    return 0;
+
+  const PathFinderTrace::Entry& entry = trace_.entries[next_];
+  if (entry.call != call || entry.argument != argument) {
+    divergence_ = next_;
+    return 0;
+  }
+  ++next_;
+  return entry.value;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+#include "PathFinding.h"
+
+//--------------------------------------------------------------------------------------------------------------
+// PathFinderTrace
+//--------------------------------------------------------------------------------------------------------------
+
+// Every hardware call a PathFinder made, in order, with its result. Enough to run the state machine again without
+// the car or the simulator. move() is followed by two POSITION entries holding currentNode_.x and .y afterwards,
+// the implementation tracks the position itself.
+//
+// File: TraceFileHeader followed by entryCount packed 5 byte entries in host byte order, little endian only:
+//       byte 0    call | argument << 4 (argument is the SensorDirection of MEASURE_DISTANCE, 0/1 for x/y of POSITION)
+//       byte 1-4  result as float, bools as 0 or 1
+struct PathFinderTrace {
+  enum class Call : std::uint8_t {
+    MOVE,
+    TURN_RIGHT,
+    TURN_LEFT,
+    MEASURE_DISTANCE,
+    TOUCH_WALL_TOP,
+    TRAVELLED_DIST,
+    POSITION,
+  };
+
+  struct Entry {
+    Call call;
+    std::uint8_t argument;
+    float value;
+  };
+
+  bool save(const std::filesystem::path& path) const;
+  static std::optional<PathFinderTrace> load(const std::filesystem::path& path); // nullopt if unreadable or of another version
+
+  PathFinder::Parameters parameters; // the run was made with
+  std::vector<Entry> entries;
+};
+
+struct TraceFileHeader {
+  static constexpr char magicBytes[4] = { 'P', 'F', 'T', 'R' };
+  static constexpr std::uint32_t currentVersion = 1;
+  static constexpr std::size_t entrySize = 5; // bytes per PathFinderTrace::Entry in the file
+
+  char magic[4];
+  std::uint32_t version;
+  float wallThreshold;
+  float junctionOffset;
+  std::uint32_t entryCount;
+  std::uint32_t reserved; // 0
+};
+
+static_assert(sizeof(TraceFileHeader) == 24);
+static_assert(std::endian::native == std::endian::little, "trace files are little endian");
+
+//--------------------------------------------------------------------------------------------------------------
+// PathFinderRecorder
+//--------------------------------------------------------------------------------------------------------------
+
+// Wraps any PathFinder implementation (PathFinderSim, the car firmware) and logs its calls while recording.
+// Calls an implementation makes to itself, e.g. touchWallTop() measuring TOP, are not logged, the replay
+// answers the outer call only.
+template <typename Base>
+struct PathFinderRecorder : Base {
+  using Base::Base;
+  using Base::move;
+
+  void startRecording() {
+    trace_ = PathFinderTrace{ this->parameters(), {} };
+    recording_ = true;
+  }
+  void stopRecording()                                  { recording_ = false; }
+  const PathFinderTrace& trace() const                  { return trace_; }
+
+  float move() override {
+    float dist = log(PathFinderTrace::Call::MOVE, 0, [this] { return Base::move(); });
+    if (recording_ && depth_ == 0) {
+      trace_.entries.push_back({ PathFinderTrace::Call::POSITION, 0, this->currentNode_.x.val });
+      trace_.entries.push_back({ PathFinderTrace::Call::POSITION, 1, this->currentNode_.y.val });
+    }
+    return dist;
+  }
+  bool turn90RightImpl() override                       { return log(PathFinderTrace::Call::TURN_RIGHT, 0, [this] { return Base::turn90RightImpl(); }); }
+  bool turn90LeftImpl() override                        { return log(PathFinderTrace::Call::TURN_LEFT, 0, [this] { return Base::turn90LeftImpl(); }); }
+  bool touchWallTop() override                          { return log(PathFinderTrace::Call::TOUCH_WALL_TOP, 0, [this] { return Base::touchWallTop(); }); }
+  float travelledDist() override                        { return log(PathFinderTrace::Call::TRAVELLED_DIST, 0, [this] { return Base::travelledDist(); }); }
+  float measureDistance(SensorDirection direction) override {
+    return log(PathFinderTrace::Call::MEASURE_DISTANCE, (std::uint8_t)direction, [this, direction] { return Base::measureDistance(direction); });
+  }
+
+private:
+  template <typename F>
+  auto log(PathFinderTrace::Call call, std::uint8_t argument, F&& f) {
+    if (!recording_ || depth_ > 0)
+      return f();
+    ++depth_;
+    auto value = f();
+    --depth_;
+    trace_.entries.push_back({ call, argument, (float)value });
+    return value;
+  }
+
+  PathFinderTrace trace_;
+  bool recording_ = false;
+  int depth_ = 0;
+};
+
+//--------------------------------------------------------------------------------------------------------------
+// PathFinderReplay
+//--------------------------------------------------------------------------------------------------------------
+
+// Answers every call from a trace, no physics involved. As long as the state machine asks the same questions in
+// the same order the run is reproduced exactly; the first call that differs is remembered in divergence(), from
+// then on and after the end of the trace every call answers 0.
+struct PathFinderReplay : PathFinder {
+  explicit PathFinderReplay(PathFinderTrace trace);
+
+  float move() override;
+  bool turn90RightImpl() override                       { return next(PathFinderTrace::Call::TURN_RIGHT, 0) != 0; }
+  bool turn90LeftImpl() override                        { return next(PathFinderTrace::Call::TURN_LEFT, 0) != 0; }
+  float measureDistance(SensorDirection direction) override { return next(PathFinderTrace::Call::MEASURE_DISTANCE, (std::uint8_t)direction); }
+  bool touchWallTop() override                          { return next(PathFinderTrace::Call::TOUCH_WALL_TOP, 0) != 0; }
+  float travelledDist() override                        { return next(PathFinderTrace::Call::TRAVELLED_DIST, 0); }
+  void uploadNode(const Node&) override                 {}
+
+  bool finished() const                                 { return next_ >= trace_.entries.size() || divergence_.has_value(); }
+  std::size_t replayed() const                          { return next_; } // entries answered so far
+  std::optional<std::size_t> divergence() const         { return divergence_; } // index of the first entry that did not match
+
+private:
+  float next(PathFinderTrace::Call call, std::uint8_t argument);
+
+  PathFinderTrace trace_;
+  std::size_t next_ = 0;
+  std::optional<std::size_t> divergence_;
+};
@@ -0,0 +1,152 @@
+#include "Profiler.h"
+
+#ifdef SIM_PROFILE
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+//--------------------------------------------------------------------------------------------------------------
+// ThreadBuffer
+//--------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+// What one thread measured, handed to the Profiler when the thread ends. Constructing the Profiler first makes
+// sure it outlives every buffer.
+struct ThreadBuffer {
+  ThreadBuffer() : profiler(Profiler::instance()) {}
+  ~ThreadBuffer() { profiler.merge(stats, events); }
+
+  Profiler::Stats& operator [] (std::uint32_t site) {
+    if (site >= stats.size())
+      stats.resize(site + 1);
+    return stats[site];
+  }
+
+  Profiler& profiler;
+  std::vector<Profiler::Stats> stats; // indexed by site id
+  std::deque<Profiler::Event> events; // grows without copying what is already recorded
+};
+
+thread_local ThreadBuffer buffer;
+
+std::int64_t nanoseconds(Profiler::Clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+} // end of anonymous namespace
+
+//--------------------------------------------------------------------------------------------------------------
+// ProfileSite
+//--------------------------------------------------------------------------------------------------------------
+
+//------ ProfileSite ------
+ProfileSite::ProfileSite(const char* name, bool counter) : name(name), counter(counter) {
+  id = Profiler::instance().registerSite(this);
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// Profiler
+//--------------------------------------------------------------------------------------------------------------
+
+//------ instance ------
+Profiler& Profiler::instance() {
+  static Profiler profiler;
+  return profiler;
+}
+
+//------ record ------
+void Profiler::record(const ProfileSite& site, Clock::time_point start, Clock::time_point end) {
+  ThreadBuffer& thread = buffer;
+  std::int64_t duration = nanoseconds(end - start);
+
+  Stats& stats = thread[site.id];
+  ++stats.count;
+  stats.totalNs += (std::uint64_t)duration;
+  stats.maxNs = std::max(stats.maxNs, (std::uint64_t)duration);
+
+  if (thread.events.size() < maxEvents)
+    thread.events.push_back({ site.id, 0, nanoseconds(start - thread.profiler.start()), duration });
+}
+
+//------ count ------
+void Profiler::count(const ProfileSite& site, std::uint64_t n) {
+  buffer[site.id].count += n;
+}
+
+//------ registerSite ------
+std::uint32_t Profiler::registerSite(const ProfileSite* site) {
+  std::lock_guard lock(mutex_);
+  sites_.push_back(site);
+  stats_.resize(sites_.size());
+  return (std::uint32_t)(sites_.size() - 1);
+}
+
+//------ merge ------
+void Profiler::merge(const std::vector<Stats>& stats, std::deque<Event>& events) {
+  std::lock_guard lock(mutex_);
+  for (std::size_t i = 0; i < stats.size(); ++i) {
+    stats_[i].count += stats[i].count;
+    stats_[i].totalNs += stats[i].totalNs;
+    stats_[i].maxNs = std::max(stats_[i].maxNs, stats[i].maxNs);
+  }
+  for (Event& event : events)
+    event.thread = threads_;
+  events_.insert(events_.end(), events.begin(), events.end());
+  ++threads_;
+}
+
+//------ ~Profiler ------
+Profiler::~Profiler() {
+  writeSummary();
+  writeTrace();
+}
+
+//------ writeSummary ------
+void Profiler::writeSummary() const {
+  std::vector<std::size_t> order;
+  for (std::size_t i = 0; i < sites_.size(); ++i) {
+    if (stats_[i].count > 0)
+      order.push_back(i);
+  }
+  std::sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+    if (sites_[a]->counter != sites_[b]->counter)
+      return !sites_[a]->counter; // timers first
+    return sites_[a]->counter ? stats_[a].count > stats_[b].count : stats_[a].totalNs > stats_[b].totalNs;
+  });
+
+  std::cerr << "\n" << std::left << std::setw(40) << "scope" << std::right << std::setw(14) << "calls"
+            << std::setw(14) << "total ms" << std::setw(14) << "mean us" << std::setw(14) << "max us" << "\n";
+  std::cerr << std::fixed << std::setprecision(3);
+  for (std::size_t i : order) {
+    const Stats& stats = stats_[i];
+    std::cerr << std::left << std::setw(40) << sites_[i]->name << std::right << std::setw(14) << stats.count;
+    if (!sites_[i]->counter) {
+      std::cerr << std::setw(14) << stats.totalNs / 1e6 << std::setw(14) << stats.totalNs / 1e3 / stats.count
+                << std::setw(14) << stats.maxNs / 1e3;
+    }
+    std::cerr << "\n";
+  }
+}
+
+//------ writeTrace ------
+void Profiler::writeTrace() const {
+  const char* path = std::getenv("SIM_PROFILE_TRACE");
+  std::ofstream file(path ? path : "profile.json");
+  if (!file)
+    return;
+
+  file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+  for (std::size_t i = 0; i < events_.size(); ++i) {
+    const Event& event = events_[i];
+    file << (i == 0 ? "" : ",\n") << "{\"name\":\"" << sites_[event.site]->name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+         << event.thread << ",\"ts\":" << event.startNs / 1e3 << ",\"dur\":" << event.durationNs / 1e3 << "}";
+  }
+  file << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+#endif
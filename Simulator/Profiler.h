@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------------------
+// Profiler
+//--------------------------------------------------------------------------------------------------------------
+
+// Scoped timers and counters, compiled in only with SIM_PROFILE defined (/D SIM_PROFILE, -DSIM_PROFILE).
+// Without it PROFILE_SCOPE and PROFILE_COUNT expand to nothing.
+//
+//   PROFILE_SCOPE("MOVE_TO_JUNCTION");     // times the rest of the enclosing scope
+//   PROFILE_COUNT("WallGrid::raycast", 1); // adds to a counter
+//
+// A scope reads the clock twice and logs an event, so it belongs on coarse work: search() steps, state handlers,
+// Floyd-Warshall passes. Functions running for well under a microsecond get a counter instead.
+//
+// Each thread accumulates into its own buffer, so instrumented code shares nothing between threads. At exit a
+// summary table goes to std::cerr and the timed scopes are written as a Chrome trace (chrome://tracing, Perfetto)
+// to $SIM_PROFILE_TRACE or profile.json. Only the first maxEvents scopes of each thread make it into the trace,
+// the summary counts all of them.
+
+#ifdef SIM_PROFILE
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) \
+  static const ProfileSite PROFILE_CONCAT(profileSite_, __LINE__)(name); \
+  ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(PROFILE_CONCAT(profileSite_, __LINE__))
+#define PROFILE_COUNT(name, n) \
+  do { static const ProfileSite profileSite_(name, true); Profiler::count(profileSite_, (std::uint64_t)(n)); } while (0)
+
+// One PROFILE_SCOPE or PROFILE_COUNT in the source, registered on first use.
+struct ProfileSite {
+  ProfileSite(const char* name, bool counter = false);
+
+  const char* name;
+  bool counter;
+  std::uint32_t id;
+};
+
+struct Profiler {
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::size_t maxEvents = 1 << 20; // per thread
+
+  struct Stats {
+    std::uint64_t count{0}; // scopes run, or sum of the counted values
+    std::uint64_t totalNs{0};
+    std::uint64_t maxNs{0};
+  };
+
+  struct Event {
+    std::uint32_t site;
+    std::uint32_t thread;
+    std::int64_t startNs; // since the profiler started
+    std::int64_t durationNs;
+  };
+
+  static void record(const ProfileSite& site, Clock::time_point start, Clock::time_point end);
+  static void count(const ProfileSite& site, std::uint64_t n);
+
+  static Profiler& instance();
+  ~Profiler(); // writes the summary and the trace
+
+  std::uint32_t registerSite(const ProfileSite* site);
+  void merge(const std::vector<Stats>& stats, std::deque<Event>& events);
+  Clock::time_point start() const { return start_; }
+
+private:
+  Profiler() = default;
+
+  void writeSummary() const;
+  void writeTrace() const;
+
+  Clock::time_point start_{Clock::now()};
+  std::mutex mutex_;
+  std::vector<const ProfileSite*> sites_;
+  std::vector<Stats> stats_;   // indexed by site id, merged from finished threads
+  std::vector<Event> events_;
+  std::uint32_t threads_{0};   // threads merged so far
+};
+
+struct ProfileScope {
+  explicit ProfileScope(const ProfileSite& site) : site_(site), start_(Profiler::Clock::now()) {}
+  ~ProfileScope() { Profiler::record(site_, start_, Profiler::Clock::now()); }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator = (const ProfileScope&) = delete;
+
+private:
+  const ProfileSite& site_;
+  Profiler::Clock::time_point start_;
+};
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNT(name, n) ((void)0)
+
+#endif
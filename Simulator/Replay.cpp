@@ -0,0 +1,47 @@
+#include "PathFindingTrace.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+//--------------------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------------------
+
+// usage: Replay trace
+// Runs PathFinder on the answers recorded by Headless --record (or on the car) until the trace is used up, the
+// state machine asks something else than it did when recording, or exploration finishes.
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "usage: Replay trace\n";
+    return 2;
+  }
+  auto trace = PathFinderTrace::load(argv[1]);
+  if (!trace.has_value()) {
+    std::cerr << "can not read trace " << argv[1] << "\n";
+    return 2;
+  }
+
+  std::size_t entries = trace->entries.size();
+  PathFinderReplay pathFinder(std::move(trace.value()));
+
+  long steps = 0;
+  auto start = std::chrono::steady_clock::now();
+  while (!pathFinder.finished() && pathFinder.state() != PathFinder::State::WAIT) {
+    pathFinder.search();
+    ++steps;
+  }
+  std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+  std::cout << (pathFinder.state() == PathFinder::State::WAIT ? "exploration finished" : "exploration aborted") << "\n"
+            << "time:     " << time.count() << " s\n"
+            << "steps:    " << steps << "\n"
+            << "nodes:    " << pathFinder.nodeCount() << "\n"
+            << "replayed: " << pathFinder.replayed() << " of " << entries << " calls\n";
+
+  if (pathFinder.divergence().has_value()) {
+    std::cout << "diverged at call " << pathFinder.divergence().value() << "\n";
+    return 1;
+  }
+  return pathFinder.state() == PathFinder::State::WAIT ? 0 : 1;
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <iostream>
+#include <array>
+#include <cstdint>
 
 enum SensorDirection {
   TOPRIGHT,
@@ -8,4 +10,34 @@ enum SensorDirection {
   BOTTOMRIGHT,
   BOTTOMLEFT,
   TOP,
-};
\ No newline at end of file
+};
+
+//--------------------------------------------------------------------------------------------------------------
+// SensorSnapshot
+//--------------------------------------------------------------------------------------------------------------
+
+// Readings of all sensors for one pose. Each sensor is measured at most once until invalidate() is called,
+// which saves ray casts in the simulator and 250 ms pings on the car.
+struct SensorSnapshot {
+  template <typename F>
+  float get(SensorDirection direction, F&& measure) {
+    if (valid_ & (1u << direction)) {
+      ++hits;
+      return values_[direction];
+    }
+    ++misses;
+    valid_ |= 1u << direction;
+    return values_[direction] = measure(direction);
+  }
+
+  void invalidate() { valid_ = 0; }
+
+  double hitRate() const { return hits + misses == 0 ? 0.0 : (double)hits / (double)(hits + misses); }
+
+  std::uint64_t hits{0};
+  std::uint64_t misses{0};
+
+private:
+  std::array<float, 5> values_{};
+  std::uint8_t valid_{0};
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <algorithm>
+
+//--------------------------------------------------------------------------------------------------------------
+// SimulationClock
+//--------------------------------------------------------------------------------------------------------------
+
+// Fixed timestep clock for the simulation. Real time is scaled by speed() and cut into steps of
+// 1 / stepsPerSecond, so the car moves at the same simulated speed whatever the frame rate is. Speed 0 means as
+// fast as possible, the caller then runs steps until its frame budget is spent.
+struct SimulationClock {
+  SimulationClock(double stepsPerSecond = 60) : stepTime_(1.0 / stepsPerSecond) {}
+
+  // steps to run for a frame that took frameTime seconds
+  long advance(double frameTime) {
+    if (unlimited())
+      return 0;
+    accumulator_ += std::min(frameTime, maxFrameTime_) * speed_;
+    long steps = (long)(accumulator_ / stepTime_);
+    accumulator_ -= steps * stepTime_;
+    return steps;
+  }
+
+  // how far the simulation is between the last step and the next one, for drawing
+  float alpha() const { return unlimited() ? 1.0f : (float)(accumulator_ / stepTime_); }
+
+  double speed() const { return speed_; }
+  bool unlimited() const { return speed_ == 0; }
+  void setSpeed(double speed) { speed_ = std::max(speed, 0.0); accumulator_ = 0; }
+
+  void faster() { setSpeed(unlimited() ? maxSpeed_ : std::min(speed_ * 2, maxSpeed_)); }
+  void slower() { setSpeed(unlimited() ? maxSpeed_ : std::max(speed_ / 2, minSpeed_)); }
+
+private:
+  static constexpr double maxFrameTime_ = 0.25; // frames longer than this are simulated slower instead of catching up
+  static constexpr double minSpeed_ = 1.0 / 16;
+  static constexpr double maxSpeed_ = 1024;
+
+  double stepTime_;
+  double speed_{1};
+  double accumulator_{0};
+};
@@ -1,4 +1,5 @@
 #include "Simulator.h"
+#include "Profiler.h"
 
 using namespace sf;
 
@@ -34,59 +35,68 @@ void Object::keyBoardMove() {
     backTrackedTurn(false);
 }
 
-bool Object::backTrackedMove(Vector2f direct) {
+//------ freeDistance ------
+// Tries the whole move, the object either fits there or stays.
+float Object::freeDistance(Vector2f direct) {
   Vector2f savedPos = pShape_->getPosition();
-  move(direct);
+  pShape_->setPosition(savedPos + direct);
 
+  bool free = true;
   for (auto& pDrawable : *pWalls) {
-    if (pDrawable.get() == this)
-      continue;
-    if (collides(((Object*)(pDrawable.get()))->pShape_->getGlobalBounds())) {
-      move2(savedPos);
-      return false;
+    if (pDrawable.get() != this && collides(((Object*)(pDrawable.get()))->pShape_->getGlobalBounds())) {
+      free = false;
+      break;
     }
   }
-  return true;
+  pShape_->setPosition(savedPos);
+  return free ? std::sqrt(direct.x * direct.x + direct.y * direct.y) : 0.0f;
 }
 
-bool Object::backTrackedTurn(bool right) {
-  if (right)
-    turn(true);
-  else
-    turn(false);
+//------ sweptMove ------
+float Object::sweptMove(Vector2f direct) {
+  PROFILE_COUNT("Object::sweptMove", 1);
+  float length = std::sqrt(direct.x * direct.x + direct.y * direct.y);
+  if (length == 0)
+    return 0;
+
+  float distance = std::min(freeDistance(direct), length);
+  if (distance == length)
+    move(direct);
+  else if (distance > 0)
+    move(direct * (distance / length));
+  return distance;
+}
 
+//------ backTrackedMove ------
+bool Object::backTrackedMove(Vector2f direct) {
+  return sweptMove(direct) == std::sqrt(direct.x * direct.x + direct.y * direct.y);
+}
+
+//------ overlapsWall ------
+bool Object::overlapsWall() {
   for (auto& pDrawable : *pWalls) {
-    if (pDrawable.get() == this)
-      continue;
-    if (collides(((Object*)(pDrawable.get()))->pShape_->getGlobalBounds())) {
-      if (right)
-        turn(false);
-      else
-        turn(true);
-      return false;
-    }
+    if (pDrawable.get() != this && collides(((Object*)(pDrawable.get()))->pShape_->getGlobalBounds()))
+      return true;
   }
-  return true;
+  return false;
 }
 
-bool Object::backTrackedTurn90(bool right) {
-  if (right)
-    turn90(true);
-  else
-    turn90(false);
+//------ backTrackedTurn ------
+bool Object::backTrackedTurn(bool right) {
+  turn(right);
+  if (!overlapsWall())
+    return true;
+  turn(!right);
+  return false;
+}
 
-  for (auto& pDrawable : *pWalls) {
-    if (pDrawable.get() == this)
-      continue;
-    if (collides(((Object*)(pDrawable.get()))->pShape_->getGlobalBounds())) {
-      if (right)
-        turn90(false);
-      else
-        turn90(true);
-      return false;
-    }
-  }
-  return true;
+//------ backTrackedTurn90 ------
+bool Object::backTrackedTurn90(bool right) {
+  turn90(right);
+  if (!overlapsWall())
+    return true;
+  turn90(!right);
+  return false;
 }
 
 //--------------------------------------------------------------------------------------------------------------
@@ -152,78 +162,9 @@ bool GenerateDrawable::delay() const {
 // DistanceSensor
 //--------------------------------------------------------------------------------------------------------------
 
-//------ DistanceSensor ------
-DistanceSensor::DistanceSensor(Vector2f direct, Vector2f pos, int radius) {
-  Object::pShape_ = std::shared_ptr<CircleShape>(new CircleShape((float)radius));
-  Object::pShape_->setFillColor(Color::Red);
-  Object::pShape_->setPosition(pos);
-
-  Object::front = direct;
-}
-
-//------ operator = ------
-DistanceSensor& DistanceSensor::operator = (const DistanceSensor& rhs) {
-  this->pShape_ = rhs.pShape_;
-  this->front = rhs.front;
-  return *this;
-}
-
 //------ measureDistance ------
 float DistanceSensor::measureDistance() const {
-  float ret = 10000;
-  for (auto pWall : *pWalls) {
-    if (auto distance = rectangleDistance(*(RectangleShape*)((Object*)pWall.get())->shape().get());
-        distance.has_value())
-      ret = distance.value() < ret ? distance.value() : ret;
-  }
-
-  return ret;
-}
-
-//------ rectangleDistance ------
-std::optional<float> DistanceSensor::rectangleDistance(const RectangleShape& rectangle) const {
-  float width = rectangle.getSize().x;
-  float height = rectangle.getSize().y;
-
-  float centerX = rectangle.getPosition().x;
-  float centerY = rectangle.getPosition().y;
-
-  float rectLeft = centerX - width / 2.0f;
-  float rectRight = centerX + width / 2.0f;
-  float rectTop = centerY - height / 2.0f;
-  float rectBottom = centerY + height / 2.0f;
-
-  std::vector<float> distances;
-  Vector2f pos = Object::pShape_->getPosition();
-  pos += Vector2f(((CircleShape*)(Object::pShape_.get()))->getRadius(), ((CircleShape*)(Object::pShape_.get()))->getRadius());
-
-  Vector2f direction = Object::front;
-
-  if (direction.x != 0) {
-    float tLeft = (rectLeft - pos.x) / direction.x;
-    float yLeft = pos.y + tLeft * direction.y;
-    if (tLeft >= 0 && yLeft >= rectTop && yLeft <= rectBottom) distances.push_back(tLeft);
-
-    float tRight = (rectRight - pos.x) / direction.x;
-    float yRight = pos.y + tRight * direction.y;
-    if (tRight >= 0 && yRight >= rectTop && yRight <= rectBottom) distances.push_back(tRight);
-  }
-
-  if (direction.y != 0) {
-    float tTop = (rectTop - pos.y) / direction.y;
-    float xTop = pos.x + tTop * direction.x;
-    if (tTop >= 0 && xTop >= rectLeft && xTop <= rectRight) distances.push_back(tTop);
-
-    float tBottom = (rectBottom - pos.y) / direction.y;
-    float xBottom = pos.x + tBottom * direction.x;
-    if (tBottom >= 0 && xBottom >= rectLeft && xBottom <= rectRight) distances.push_back(tBottom);
-  }
-
-  if (!distances.empty()) {
-    return *std::min_element(distances.begin(), distances.end());
-  }
-
-  return std::nullopt; // No intersection found
+  return pWallGrid->raycast(position, front, 10000);
 }
 
 //--------------------------------------------------------------------------------------------------------------
@@ -231,8 +172,8 @@ std::optional<float> DistanceSensor::rectangleDistance(const RectangleShape& rec
 //--------------------------------------------------------------------------------------------------------------
 
 //------ Car ------
-Car::Car(Vector2f pos, std::function<Object*(Object*)> lambda)
-  : Clickable(lambda), sensorsText_(5) {
+Car::Car(Vector2f pos, std::function<Object*(Object*)> lambda, bool hud)
+  : Clickable(lambda), sensorsText_(hud ? 5 : 0) {
   Clickable::pShape_ = std::make_shared<RectangleShape>(Vector2f{75, 100});
 
   Clickable::pShape_->setFillColor(Color::Blue);
@@ -240,14 +181,6 @@ Car::Car(Vector2f pos, std::function<Object*(Object*)> lambda)
     Clickable::pShape_->getLocalBounds().height / 2.0f);
   Clickable::pShape_->setPosition(pos);
 
-  auto bounds = Clickable::pShape_->getGlobalBounds();
-  int radius = 10;
-  sensors.push_back(DistanceSensor(Vector2f(1, 0), Vector2f(0, 0), radiusSensors));
-  sensors.push_back(DistanceSensor(Vector2f(-1, 0), Vector2f(0, 0), radiusSensors));
-  sensors.push_back(DistanceSensor(Vector2f(1, 0), Vector2f(0, 0), radiusSensors));
-  sensors.push_back(DistanceSensor(Vector2f(-1, 0), Vector2f(0, 0), radiusSensors));
-  sensors.push_back(DistanceSensor(Vector2f(0, -1), Vector2f(0, 0), radiusSensors));
-
   int yPos = 300;
   for (auto& text : sensorsText_) {
     text.setFont(font_);
@@ -258,15 +191,17 @@ Car::Car(Vector2f pos, std::function<Object*(Object*)> lambda)
   }
   Object::front = Vector2f(0, -1);
 
-  updateSensorPositions();
+  updatePose();
 }
 
 //------ update ------
-void Car::update() {
+void Car::update(const std::array<float, 5>& distances) {
+  if (sensorsText_.empty())
+    return;
   int i = 0;
   std::vector<std::string> names{"Top: ", "Left Bottom: ", "Right Bottom: ", "Left Top: ", "Right Top: "};
-  for (auto&& [sensor, name] : std::views::zip(sensors, std::views::reverse(names))) {
-    sensorsText_[i].setString(name + std::to_string(sensor.measureDistance()));
+  for (auto&& [distance, name] : std::views::zip(distances, std::views::reverse(names))) {
+    sensorsText_[i].setString(name + std::to_string(distance));
     ++i;
   }
 }
@@ -274,8 +209,13 @@ void Car::update() {
 //------ draw ------
 void Car::draw(RenderTarget& target, RenderStates states) const {
   Object::draw(target, states);
-  for (auto& sensor : sensors)
-    sensor.draw(target, states);
+
+  CircleShape sensorShape((float)radiusSensors);
+  sensorShape.setFillColor(Color::Red);
+  for (auto& sensor : sensors) {
+    sensorShape.setPosition(sensor.position - Vector2f((float)radiusSensors, (float)radiusSensors));
+    target.draw(sensorShape, states);
+  }
 
   for (auto& text : sensorsText_)
     target.draw(text);
@@ -283,33 +223,68 @@ void Car::draw(RenderTarget& target, RenderStates states) const {
 
 //------ collides ------
 bool Car::collides(FloatRect rect) {
-  for (auto& edge : edges()) {
+  for (auto& edge : edges_) {
     if (rect.contains(edge))
       return true;
   }
   return false;
 }
 
-//------ edges ------
-std::vector<Vector2f> Car::edges() {
-  RectangleShape car = *((RectangleShape*)Object::pShape_.get());
-  return {
-    car.getTransform().transformPoint(Vector2f(car.getSize().x, 0)), // top right
-    car.getTransform().transformPoint(Vector2f(0, 0)), // top left
-    car.getTransform().transformPoint(Vector2f(car.getSize().x, car.getSize().y)), // bottom right
-    car.getTransform().transformPoint(Vector2f(0, car.getSize().y)), // bottom left
-    car.getTransform().transformPoint(sf::Vector2f(car.getSize().x / 2, 0)) // top middle
-  };
+//------ freeDistance ------
+// Sweeps the car rectangle along direct against the walls near its path, so no step is too long to hit a wall.
+float Car::freeDistance(Vector2f direct) {
+  constexpr float skin = 0.01f; // stays that far away from walls so float errors never start it inside one
+
+  float length = std::sqrt(direct.x * direct.x + direct.y * direct.y);
+  if (length == 0)
+    return 0;
+  Vector2f direction = direct / length;
+
+  std::array<Vector2f, 4> corners = this->corners();
+
+  FloatRect start = Object::pShape_->getGlobalBounds();
+  FloatRect path(std::min(start.left, start.left + direct.x) - skin, std::min(start.top, start.top + direct.y) - skin,
+    start.width + std::abs(direct.x) + 2 * skin, start.height + std::abs(direct.y) + 2 * skin);
+
+  float limit = length + skin;
+  float distance = limit;
+  pWallGrid->query(path, [&](const FloatRect& wall) {
+    distance = std::min(distance, sweptDistance(corners, direction, distance, wall));
+  });
+  return distance == limit ? length : std::clamp(distance - skin, 0.0f, length);
 }
 
-//------ updateSensorPositions ------
-void Car::updateSensorPositions() {
-  auto bounds = Clickable::pShape_->getGlobalBounds();
-  sensors[0].move2(Vector2f(edges()[0].x - radiusSensors, edges()[0].y - radiusSensors));
-  sensors[1].move2(Vector2f(edges()[1].x - radiusSensors, edges()[1].y - radiusSensors));
-  sensors[2].move2(Vector2f(edges()[2].x - radiusSensors, edges()[2].y - radiusSensors));
-  sensors[3].move2(Vector2f(edges()[3].x - radiusSensors, edges()[3].y - radiusSensors));
-  sensors[4].move2(Vector2f(edges()[4].x - radiusSensors, edges()[4].y - radiusSensors));
+//------ overlapsWall ------
+// The rotated car rectangle against the walls the grid has near it.
+bool Car::overlapsWall() {
+  std::array<Vector2f, 4> corners = this->corners();
+  bool overlapping = false;
+  pWallGrid->query(Object::pShape_->getGlobalBounds(), [&](const FloatRect& wall) {
+    overlapping = overlapping || overlaps(corners, wall);
+  });
+  return overlapping;
+}
+
+//------ updatePose ------
+void Car::updatePose() {
+  const RectangleShape& car = *((RectangleShape*)Object::pShape_.get());
+  const Transform& transform = car.getTransform();
+  Vector2f size = car.getSize();
+  edges_ = {
+    transform.transformPoint(Vector2f(size.x, 0)), // top right
+    transform.transformPoint(Vector2f(0, 0)), // top left
+    transform.transformPoint(Vector2f(size.x, size.y)), // bottom right
+    transform.transformPoint(Vector2f(0, size.y)), // bottom left
+    transform.transformPoint(Vector2f(size.x / 2, 0)) // top middle
+  };
+
+  Vector2f right(-Object::front.y, Object::front.x);
+  for (int i = 0; i < 5; ++i)
+    sensors[i].position = edges_[i];
+  sensors[TOPRIGHT].front = sensors[BOTTOMRIGHT].front = right;
+  sensors[TOPLEFT].front = sensors[BOTTOMLEFT].front = -right;
+  sensors[TOP].front = Object::front;
+  ++poseVersion_;
 }
 
 //------ turn ------
@@ -320,9 +295,7 @@ void Car::turn(bool right) {
   else
     ((RectangleShape*)(Object::pShape_.get()))->rotate(-Object::turnSpeed_);
 
-  updateSensorPositions();
-  for (auto& sensor : sensors)
-    sensor.turn(right);
+  updatePose();
 }
 
 //------ turn90 ------
@@ -333,9 +306,7 @@ void Car::turn90(bool right) {
   else
     ((RectangleShape*)(Object::pShape_.get()))->rotate(-90);
 
-  updateSensorPositions();
-  for (auto& sensor : sensors)
-    sensor.turn90(right);
+  updatePose();
 }
 
 //--------------------------------------------------------------------------------------------------------------
@@ -343,7 +314,7 @@ void Car::turn90(bool right) {
 //--------------------------------------------------------------------------------------------------------------
 
 //------ DrawNode ------
-DrawNode::DrawNode(Vector2f pos, std::function<Object*(Object*)> lambda, std::shared_ptr<Node> pNode) :  Clickable(lambda), pNode(pNode) {
+DrawNode::DrawNode(Vector2f pos, std::function<Object*(Object*)> lambda, NodeId id) :  Clickable(lambda), id(id) {
   Object::pShape_ = std::shared_ptr<CircleShape>(new CircleShape((float)25));
   Object::pShape_->setFillColor(Color::Red);
   Object::pShape_->setPosition(Vector2f(pos.x - 25, pos.y - 25));
@@ -352,37 +323,122 @@ DrawNode::DrawNode(Vector2f pos, std::function<Object*(Object*)> lambda, std::sh
 //------ DrawNode ------
 DrawNode& DrawNode::operator = (const DrawNode& rhs) {
   this->pShape_ = rhs.pShape_;
-  this->pNode = rhs.pNode;
+  this->id = rhs.id;
   return *this;
 }
 
+//--------------------------------------------------------------------------------------------------------------
+// ShapeBatch
+//--------------------------------------------------------------------------------------------------------------
+
+//------ add ------
+void ShapeBatch::add(const Shape& shape) {
+  Transform transform = shape.getTransform();
+  Color color = shape.getFillColor();
+  Vector2f first = transform.transformPoint(shape.getPoint(0));
+
+  // fan around the first point
+  for (std::size_t i = 1; i + 1 < shape.getPointCount(); ++i) {
+    vertices_.append(Vertex(first, color));
+    vertices_.append(Vertex(transform.transformPoint(shape.getPoint(i)), color));
+    vertices_.append(Vertex(transform.transformPoint(shape.getPoint(i + 1)), color));
+  }
+  ++shapes_;
+}
+
 //--------------------------------------------------------------------------------------------------------------
 // Simulator
 //--------------------------------------------------------------------------------------------------------------
 
 //------ Simulator ------
-Simulator::Simulator() : window(sf::VideoMode(1600, 1200), "Labyrinth") {
-  pWalls = &walls;
+Simulator::Simulator(bool headless, const Maze& maze) {
+  if (!headless)
+    window.emplace(sf::VideoMode(1600, 1200), "Labyrinth");
+  bind();
 
   auto moveObj = [&](Object* pClickable) -> Object* {
-    pClickable->move2(window.mapPixelToCoords(Mouse::getPosition(window)));
+    if (window)
+      pClickable->move2(window->mapPixelToCoords(Mouse::getPosition(*window)));
     return nullptr; };
 
-  auto createHWall = [moveObj](Object*) { return new Wall(Vector2f{400, 300}, false, moveObj); };
-  auto createVWall = [moveObj](Object*) { return new Wall(Vector2f{400, 300}, true, moveObj); };
-
-  std::shared_ptr<Drawable> horizontalGenerator(new GenerateDrawable(Vector2f{50, 50}, Vector2f{50, 50}, createHWall,
-    "   generate \nhorizontal wall"));
-  std::shared_ptr<Drawable> verticalGenerator(new GenerateDrawable(Vector2f{50, 150}, Vector2f{50, 50}, createVWall,
-    "   generate \nvertical wall"));
-  car = std::shared_ptr<Drawable>(new Car(Vector2f{500, 500}, moveObj));
+  if (!headless) {
+    auto createHWall = [moveObj](Object*) { return new Wall(Vector2f{400, 300}, false, moveObj); };
+    auto createVWall = [moveObj](Object*) { return new Wall(Vector2f{400, 300}, true, moveObj); };
 
-  clickables.push_back(std::move(horizontalGenerator));
-  clickables.push_back(std::move(verticalGenerator));
+    clickables.push_back(std::shared_ptr<Drawable>(new GenerateDrawable(Vector2f{50, 50}, Vector2f{50, 50}, createHWall,
+      "   generate \nhorizontal wall")));
+    clickables.push_back(std::shared_ptr<Drawable>(new GenerateDrawable(Vector2f{50, 150}, Vector2f{50, 50}, createVWall,
+      "   generate \nvertical wall")));
+  }
+  car = std::shared_ptr<Drawable>(new Car(Vector2f{500, 500}, moveObj, !headless));
   clickables.push_back(car);
 
-  // maze
-  std::vector<std::tuple<Vector2f, bool>> maze = {
+  for (auto it : maze)
+    addWall(std::shared_ptr<Drawable>(new Wall(std::get<0>(it), std::get<1>(it), moveObj)));
+}
+
+//------ ~Simulator ------
+// Unbinds the thread from this world, another Simulator bound since keeps its binding.
+Simulator::~Simulator() {
+  if (pWalls == &walls)
+    pWalls = nullptr;
+  if (pWallGrid == &wallGrid)
+    pWallGrid = nullptr;
+}
+
+//------ addWall ------
+void Simulator::addWall(std::shared_ptr<Drawable> pWall) {
+  clickables.push_back(pWall);
+  walls.push_back(pWall);
+  wallGrid.insert((Object*)pWall.get());
+}
+
+//------ maze ------
+Maze Simulator::maze() const {
+  Maze maze;
+  for (auto& pWall : walls)
+    maze.push_back({ Vector2f(((Object*)pWall.get())->x(), ((Object*)pWall.get())->y()), ((Wall*)pWall.get())->horizontal() });
+  return maze;
+}
+
+//------ bind ------
+void Simulator::bind() {
+  pWalls = &walls;
+  pWallGrid = &wallGrid;
+}
+
+//------ addNode ------
+void Simulator::addNode(std::shared_ptr<Drawable> pNode) {
+  clickables.push_back(pNode);
+  nodes.push_back(pNode);
+}
+
+//------ draw ------
+void Simulator::draw(const RenderStates& carStates) {
+  if (!window)
+    return; // headless
+  if (wallBatchVersion_ != wallGrid.version() || wallBatch_.size() != walls.size()) {
+    wallBatch_.clear();
+    for (auto& pWall : walls)
+      wallBatch_.add(*((Object*)pWall.get())->shape());
+    wallBatchVersion_ = wallGrid.version();
+  }
+  if (nodeBatch_.size() > nodes.size())
+    nodeBatch_.clear();
+  for (std::size_t i = nodeBatch_.size(); i < nodes.size(); ++i)
+    nodeBatch_.add(*((Object*)nodes[i].get())->shape());
+
+  window->draw(wallBatch_);
+  window->draw(nodeBatch_);
+  for (auto& pDrawable : clickables) {
+    if (!((Object*)pDrawable.get())->batched())
+      window->draw(*pDrawable, pDrawable == car ? carStates : RenderStates::Default);
+  }
+}
+
+//------ defaultMaze ------
+Maze sf::defaultMaze() {
+  return {
   {{ 778, 1190 }, 0 },
   {{ 596, 1188 }, 0 },
   {{ 700, 1200 }, 1 },
@@ -415,11 +471,5 @@ Simulator::Simulator() : window(sf::VideoMode(1600, 1200), "Labyrinth") {
   {{ 990, 1179 }, 1 },
   {{ 1382, 1179 }, 1 },
   {{ 1538, 972 }, 0 },
-
   };
-
-  for (auto it : maze) {
-    clickables.push_back(std::shared_ptr<Drawable>(new Wall(std::get<0>(it), std::get<1>(it), moveObj)));
-    walls.push_back(clickables.back());
-  }
 }
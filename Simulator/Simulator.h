@@ -2,6 +2,8 @@
 
 #include <SFML/Graphics.hpp>
 #include <vector>
+#include <memory>
+#include <optional>
 #include <ranges>
 #include <tuple>
 #include <chrono>
@@ -10,13 +12,17 @@
 
 #include "Sensor.h"
 #include "AdjacencyMatrix.h"
+#include "WallGrid.h"
 
 using namespace std::chrono_literals;
 
 namespace sf {
 
-inline Font font_;
-inline std::vector<std::shared_ptr<Drawable>>* pWalls;
+// per thread, a Font caches glyph pages as Text uses it; main() loads the GUI thread's
+inline thread_local Font font_;
+// the world of the Simulator last bound on this thread, see Simulator::bind()
+inline thread_local std::vector<std::shared_ptr<Drawable>>* pWalls;
+inline thread_local WallGrid* pWallGrid;
 
 //------ rotateVector ------
 inline Vector2f rotateVector(const Vector2f& vector, float angleDegrees) {
@@ -59,6 +65,7 @@ public:
   }
 
   void keyBoardMove();
+  float sweptMove(Vector2f direct); // moves along direct until a wall is in the way, returns the distance moved
   bool backTrackedMove(Vector2f direct);
   bool backTrackedTurn(bool right);
   bool backTrackedTurn90(bool right);
@@ -66,6 +73,9 @@ public:
   void draw(RenderTarget& target, RenderStates states) const override { target.draw(*pShape_, states); }
 
   virtual bool collides(FloatRect rect) { return pShape_->getGlobalBounds().intersects(rect); }
+  virtual float freeDistance(Vector2f direct); // how far the object can move along direct, at most its length
+  virtual bool overlapsWall();                 // whether the object stands in a wall now, checked after turns
+  virtual bool batched() const { return false; } // drawn through a ShapeBatch by the Simulator
 
   float x() const { return pShape_->getPosition().x; }
   float y() const { return pShape_->getPosition().y; }
@@ -111,7 +121,14 @@ struct Wall : public Clickable {
     Clickable::pShape_->setPosition(pos);
   }
 
+  void move2(Vector2f pos) override {
+    Clickable::move2(pos);
+    if (pWallGrid)
+      pWallGrid->update(this);
+  }
+
   bool horizontal() { return horizontal_; }
+  bool batched() const override { return true; }
 
 private:
   bool horizontal_;
@@ -139,18 +156,15 @@ private:
 // DistanceSensor
 //--------------------------------------------------------------------------------------------------------------
 
-struct DistanceSensor : public Object {
+// Pose of one distance sensor, kept up to date by its Car.
+struct DistanceSensor {
   DistanceSensor() = default;
-
-  DistanceSensor(Vector2f direct, Vector2f pos, int radius);
-
-  DistanceSensor& operator = (const DistanceSensor& rhs);
+  DistanceSensor(Vector2f position, Vector2f front) : position(position), front(front) {}
 
   float measureDistance() const;
 
-  void draw(RenderTarget& target, RenderStates states) const override { Object::draw(target, states); }
-
-  std::optional<float> rectangleDistance(const RectangleShape& rectangle) const;
+  Vector2f position; // center of the sensor
+  Vector2f front;    // unit vector the sensor looks along
 };
 
 //--------------------------------------------------------------------------------------------------------------
@@ -158,37 +172,45 @@ struct DistanceSensor : public Object {
 //--------------------------------------------------------------------------------------------------------------
 
 struct Car : public Clickable {
-  Car(Vector2f pos, std::function<Object*(Object*)> lambda);
+  Car(Vector2f pos, std::function<Object*(Object*)> lambda, bool hud = true); // hud: Text for the sensor readings
 
-  void update();
+  void update(const std::array<float, 5>& distances); // HUD text, distances indexed by SensorDirection
 
   void draw(RenderTarget& target, RenderStates states) const override;
 
-  void move2(Vector2f pos) override { Object::move2(pos); updateSensorPositions(); }
+  void move2(Vector2f pos) override { Object::move2(pos); updatePose(); }
   void move(Vector2f direct) override {
     Object::move(direct);
+    ++poseVersion_;
     travelledDistance += std::sqrt(direct.x * direct.x + direct.y * direct.y);
-    for (auto& sensor : sensors) sensor.move(direct);
+    for (auto& edge : edges_) edge += direct;
+    for (auto& sensor : sensors) sensor.position += direct;
   }
 
   bool collides(FloatRect rect) override;
+  float freeDistance(Vector2f direct) override;
+  bool overlapsWall() override;
 
-  std::vector<Vector2f> edges();
+  const std::array<Vector2f, 5>& edges() const          { return edges_; } // topRight, topLeft, bottomRight, bottomLeft, topMiddle
 
   void turn(bool right) override;
   void turn90(bool right) override;
 
   const DistanceSensor& distanceSensor(int pos)         { return sensors[pos]; }
   float getTravelledDistance() { return travelledDistance; }
+  unsigned poseVersion() const                          { return poseVersion_; } // changes whenever the car moves or turns
 
-  std::vector<DistanceSensor> sensors; // topRight, topLeft, bottomRight, bottomLeft, topMiddle
+  std::array<DistanceSensor, 5> sensors; // topRight, topLeft, bottomRight, bottomLeft, topMiddle
 
 private:
-  void updateSensorPositions();
+  void updatePose(); // edges_ and sensors from the shape's transform, after it was moved or rotated
+  std::array<Vector2f, 4> corners() const { return { edges_[1], edges_[0], edges_[2], edges_[3] }; } // clockwise
   std::vector<Text> sensorsText_;
 
+  std::array<Vector2f, 5> edges_;
   int radiusSensors = 10;
   float travelledDistance{0};
+  unsigned poseVersion_{0};
 };
 
 //--------------------------------------------------------------------------------------------------------------
@@ -196,29 +218,70 @@ private:
 //--------------------------------------------------------------------------------------------------------------
 
 struct DrawNode : public Clickable {
-  DrawNode(Vector2f pos, std::function<Object*(Object*)> lambda, std::shared_ptr<Node> pNode);
+  DrawNode(Vector2f pos, std::function<Object*(Object*)> lambda, NodeId id);
   DrawNode() = default;
 
   DrawNode& operator = (const DrawNode& rhs);
 
   void draw(RenderTarget& target, RenderStates states) const override { Object::draw(target, states); }
+  bool batched() const override { return true; }
 
-  std::shared_ptr<Node> pNode;
+  NodeId id{};
+};
+
+//--------------------------------------------------------------------------------------------------------------
+// ShapeBatch
+//--------------------------------------------------------------------------------------------------------------
+
+// Convex shapes baked into one triangle VertexArray, so any number of them costs a single draw call.
+// Later changes to the shapes are not picked up, the owner clears and re-adds them.
+struct ShapeBatch : public Drawable {
+  void add(const Shape& shape);
+  void clear() { vertices_.clear(); shapes_ = 0; }
+
+  std::size_t size() const { return shapes_; }
+
+  void draw(RenderTarget& target, RenderStates states) const override { target.draw(vertices_, states); }
+
+private:
+  VertexArray vertices_{Triangles};
+  std::size_t shapes_{0};
 };
 
 //--------------------------------------------------------------------------------------------------------------
 // Simulator
 //--------------------------------------------------------------------------------------------------------------
 
+using Maze = std::vector<std::tuple<Vector2f, /*horizontal*/ bool>>; // wall centers
+
+Maze defaultMaze();
+
 struct Simulator {
-  Simulator();
+  // headless: builds the maze and car only, no window, no generator buttons and no Text, so it runs without a display
+  Simulator(bool headless = false, const Maze& maze = defaultMaze());
+  ~Simulator(); // unbinds pWalls and pWallGrid if they still point here
+
+  void addWall(std::shared_ptr<Drawable> pWall);
+  void addNode(std::shared_ptr<Drawable> pNode);
+  Maze maze() const; // the walls as they are now
+  void bind();        // makes these walls the world of the calling thread, done by the constructor
+
+  // walls and nodes go through one ShapeBatch each, the car is drawn with carStates
+  void draw(const RenderStates& carStates = RenderStates::Default);
 
-  RenderWindow window;
+  std::optional<RenderWindow> window; // created unless headless, a RenderWindow holds a GL context even unopened
 
   std::shared_ptr<Drawable> car;
 
   std::vector<std::shared_ptr<Drawable>> clickables;
   std::vector<std::shared_ptr<Drawable>> walls;
+  std::vector<std::shared_ptr<Drawable>> nodes;
+  WallGrid wallGrid;
+
+private:
+  ShapeBatch wallBatch_;
+  ShapeBatch nodeBatch_;
+  unsigned wallBatchVersion_{0}; // wallGrid.version() wallBatch_ was built at
 };
 
 } // end of namespace sf
@@ -0,0 +1,127 @@
+#include "WallGrid.h"
+#include "Simulator.h"
+#include "Profiler.h"
+
+using namespace sf;
+
+//--------------------------------------------------------------------------------------------------------------
+// WallGrid
+//--------------------------------------------------------------------------------------------------------------
+
+//------ cellRange ------
+IntRect WallGrid::cellRange(Object* pWall) const {
+  FloatRect bounds = pWall->shape()->getGlobalBounds();
+  return IntRect(cell(bounds.left), cell(bounds.top), cell(bounds.left + bounds.width), cell(bounds.top + bounds.height));
+}
+
+//------ insert ------
+void WallGrid::insert(Object* pWall) {
+  IntRect range = cellRange(pWall);
+  FloatRect bounds = pWall->shape()->getGlobalBounds();
+  ranges_[pWall] = range;
+  ++version_;
+
+  for (int x = range.left; x <= range.width; ++x) {
+    for (int y = range.top; y <= range.height; ++y) {
+      Cell& cell = cells_[key(x, y)];
+      cell.walls.push_back(pWall);
+      cell.bounds.push_back(bounds);
+    }
+  }
+
+  minX_ = std::min(minX_, range.left);
+  minY_ = std::min(minY_, range.top);
+  maxX_ = std::max(maxX_, range.width);
+  maxY_ = std::max(maxY_, range.height);
+}
+
+//------ update ------
+void WallGrid::update(Object* pWall) {
+  if (!ranges_.contains(pWall))
+    return;
+
+  // the cached bounds change even if the wall stays in the same cells
+  remove(pWall);
+  insert(pWall);
+}
+
+//------ remove ------
+void WallGrid::remove(Object* pWall) {
+  auto it = ranges_.find(pWall);
+  if (it == ranges_.end())
+    return;
+
+  IntRect range = it->second;
+  for (int x = range.left; x <= range.width; ++x) {
+    for (int y = range.top; y <= range.height; ++y) {
+      auto cellIt = cells_.find(key(x, y));
+      Cell& cell = cellIt->second;
+      std::size_t i = std::find(cell.walls.begin(), cell.walls.end(), pWall) - cell.walls.begin();
+      cell.walls[i] = cell.walls.back();
+      cell.walls.pop_back();
+      cell.bounds.swapErase(i);
+      if (cell.walls.empty())
+        cells_.erase(cellIt);
+    }
+  }
+  ranges_.erase(it);
+  ++version_;
+}
+
+//------ raycast ------
+float WallGrid::raycast(Vector2f origin, Vector2f direction, float maxDist) const {
+  PROFILE_COUNT("WallGrid::raycast", 1); // counted only, a timer would cost about as much as the ray
+  float best = maxDist;
+  if (cells_.empty())
+    return best;
+
+  Vector2f invDirection = inverseDirection(direction);
+
+  int x = cell(origin.x);
+  int y = cell(origin.y);
+  int stepX = direction.x > 0 ? 1 : (direction.x < 0 ? -1 : 0);
+  int stepY = direction.y > 0 ? 1 : (direction.y < 0 ? -1 : 0);
+
+  constexpr float infinity = std::numeric_limits<float>::infinity();
+  float tDeltaX = stepX != 0 ? cellSize_ * std::abs(invDirection.x) : infinity;
+  float tDeltaY = stepY != 0 ? cellSize_ * std::abs(invDirection.y) : infinity;
+  float tMaxX = stepX > 0 ? ((x + 1) * cellSize_ - origin.x) * invDirection.x
+              : stepX < 0 ? (x * cellSize_ - origin.x) * invDirection.x : infinity;
+  float tMaxY = stepY > 0 ? ((y + 1) * cellSize_ - origin.y) * invDirection.y
+              : stepY < 0 ? (y * cellSize_ - origin.y) * invDirection.y : infinity;
+
+  [[maybe_unused]] std::size_t tested = 0;
+  float t = 0;
+  while (t < best) {
+    // nothing left in the direction of travel
+    if ((stepX >= 0 && x > maxX_) || (stepX <= 0 && x < minX_) || (stepY >= 0 && y > maxY_) || (stepY <= 0 && y < minY_))
+      break;
+
+    if (auto it = cells_.find(key(x, y)); it != cells_.end()) {
+      best = std::min(best, nearestHit(origin, invDirection, it->second.bounds));
+      tested += it->second.bounds.size();
+    }
+
+    if (tMaxX < tMaxY) {
+      t = tMaxX;
+      tMaxX += tDeltaX;
+      x += stepX;
+    }
+    else {
+      t = tMaxY;
+      tMaxY += tDeltaY;
+      y += stepY;
+    }
+  }
+  PROFILE_COUNT("raycast walls tested", tested);
+  return best;
+}
+
+//------ clear ------
+void WallGrid::clear() {
+  cells_.clear();
+  ranges_.clear();
+  ++version_;
+  minX_ = minY_ = std::numeric_limits<int>::max();
+  maxX_ = maxY_ = std::numeric_limits<int>::min();
+}
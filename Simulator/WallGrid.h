@@ -0,0 +1,285 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <array>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WALLGRID_SSE2
+#endif
+
+namespace sf {
+
+struct Object;
+
+//------ inverseDirection ------
+// Componentwise 1 / direction, axis parallel rays get a huge finite value so the slab test never sees 0 * inf.
+inline Vector2f inverseDirection(Vector2f direction) {
+  return Vector2f(direction.x != 0 ? 1.0f / direction.x : std::copysign(1e30f, direction.x),
+                  direction.y != 0 ? 1.0f / direction.y : std::copysign(1e30f, direction.y));
+}
+
+//------ slabDistance ------
+// Distance along the ray to the first boundary of the box in front of the origin (the exit point when the
+// origin lies inside the box), infinity if the ray misses it.
+inline float slabDistance(Vector2f origin, Vector2f invDirection, float left, float top, float right, float bottom) {
+  float tx1 = (left - origin.x) * invDirection.x;
+  float tx2 = (right - origin.x) * invDirection.x;
+  float ty1 = (top - origin.y) * invDirection.y;
+  float ty2 = (bottom - origin.y) * invDirection.y;
+
+  float tMin = std::max(std::min(tx1, tx2), std::min(ty1, ty2));
+  float tMax = std::min(std::max(tx1, tx2), std::max(ty1, ty2));
+
+  float t = tMin >= 0 ? tMin : tMax;
+  return (tMax >= 0 && tMin <= tMax) ? t : std::numeric_limits<float>::infinity();
+}
+
+//------ sweptDistance ------
+// Distance the convex polygon corners (given in order) can travel along the unit vector direction before it
+// touches box, separating axis test over the box axes and the polygon edges. maxDist if nothing is touched within
+// maxDist. A polygon already overlapping the box gets maxDist if direction leads out along the axis of least
+// penetration, 0 otherwise.
+template <std::size_t N>
+float sweptDistance(const std::array<Vector2f, N>& corners, Vector2f direction, float maxDist, const FloatRect& box) {
+  std::array<Vector2f, N + 2> axes;
+  axes[0] = Vector2f(1, 0);
+  axes[1] = Vector2f(0, 1);
+  for (std::size_t i = 0; i < N; ++i) {
+    Vector2f edge = corners[(i + 1) % N] - corners[i];
+    axes[i + 2] = Vector2f(-edge.y, edge.x);
+  }
+
+  const std::array<Vector2f, 4> boxCorners{ Vector2f(box.left, box.top), Vector2f(box.left + box.width, box.top),
+    Vector2f(box.left + box.width, box.top + box.height), Vector2f(box.left, box.top + box.height) };
+
+  float enter = -std::numeric_limits<float>::infinity();
+  float exit = std::numeric_limits<float>::infinity();
+  float penetration = std::numeric_limits<float>::infinity();
+  bool leaving = false; // direction points out of the box along the axis of least penetration
+  for (Vector2f axis : axes) {
+    auto project = [axis](Vector2f v) { return v.x * axis.x + v.y * axis.y; };
+    float minA = std::numeric_limits<float>::infinity(), maxA = -minA, minB = minA, maxB = -minA;
+    for (Vector2f corner : corners) {
+      minA = std::min(minA, project(corner));
+      maxA = std::max(maxA, project(corner));
+    }
+    for (Vector2f corner : boxCorners) {
+      minB = std::min(minB, project(corner));
+      maxB = std::max(maxB, project(corner));
+    }
+
+    float speed = project(direction);
+    float low = maxA - minB;  // moving against the axis by this separates
+    float high = maxB - minA; // moving along it by this separates
+    if (float depth = std::min(low, high) / std::hypot(axis.x, axis.y); depth < penetration) {
+      penetration = depth;
+      leaving = low < high ? speed < 0 : speed > 0;
+    }
+
+    if (speed == 0) {
+      if (maxA <= minB || minA >= maxB)
+        return maxDist; // separated along this axis for the whole move
+      continue;
+    }
+    float t1 = (minB - maxA) / speed;
+    float t2 = (maxB - minA) / speed;
+    enter = std::max(enter, std::min(t1, t2));
+    exit = std::min(exit, std::max(t1, t2));
+    if (enter >= exit)
+      return maxDist;
+  }
+
+  if (exit <= 0 || enter >= maxDist)
+    return maxDist; // moving away or out of reach
+  if (enter <= 0)
+    return leaving ? maxDist : 0; // already overlapping
+  return enter;
+}
+
+//------ overlaps ------
+// Whether the convex polygon corners (given in order) and box share more than their boundary, separating axis
+// test over the box axes and the polygon edges.
+template <std::size_t N>
+bool overlaps(const std::array<Vector2f, N>& corners, const FloatRect& box) {
+  std::array<Vector2f, N + 2> axes;
+  axes[0] = Vector2f(1, 0);
+  axes[1] = Vector2f(0, 1);
+  for (std::size_t i = 0; i < N; ++i) {
+    Vector2f edge = corners[(i + 1) % N] - corners[i];
+    axes[i + 2] = Vector2f(-edge.y, edge.x);
+  }
+
+  const std::array<Vector2f, 4> boxCorners{ Vector2f(box.left, box.top), Vector2f(box.left + box.width, box.top),
+    Vector2f(box.left + box.width, box.top + box.height), Vector2f(box.left, box.top + box.height) };
+
+  for (Vector2f axis : axes) {
+    auto project = [axis](Vector2f v) { return v.x * axis.x + v.y * axis.y; };
+    float minA = std::numeric_limits<float>::infinity(), maxA = -minA, minB = minA, maxB = -minA;
+    for (Vector2f corner : corners) {
+      minA = std::min(minA, project(corner));
+      maxA = std::max(maxA, project(corner));
+    }
+    for (Vector2f corner : boxCorners) {
+      minB = std::min(minB, project(corner));
+      maxB = std::max(maxB, project(corner));
+    }
+    if (maxA <= minB || minA >= maxB)
+      return false;
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// WallBounds
+//--------------------------------------------------------------------------------------------------------------
+
+// Wall bounding boxes as structure of arrays, so nearestHit() can test four walls per instruction.
+struct WallBounds {
+  void push_back(const FloatRect& bounds) {
+    left.push_back(bounds.left);
+    top.push_back(bounds.top);
+    right.push_back(bounds.left + bounds.width);
+    bottom.push_back(bounds.top + bounds.height);
+  }
+
+  // removes box i by moving the last box into its place
+  void swapErase(std::size_t i) {
+    left[i] = left.back(); left.pop_back();
+    top[i] = top.back(); top.pop_back();
+    right[i] = right.back(); right.pop_back();
+    bottom[i] = bottom.back(); bottom.pop_back();
+  }
+
+  std::size_t size() const { return left.size(); }
+
+  std::vector<float> left;
+  std::vector<float> top;
+  std::vector<float> right;
+  std::vector<float> bottom;
+};
+
+//------ nearestHit ------
+// Distance to the nearest box hit by the ray, infinity if none is hit.
+inline float nearestHit(Vector2f origin, Vector2f invDirection, const WallBounds& bounds) {
+  float best = std::numeric_limits<float>::infinity();
+  std::size_t i = 0;
+  std::size_t size = bounds.size();
+
+#ifdef WALLGRID_SSE2
+  if (size >= 4) {
+    const __m128 originX = _mm_set1_ps(origin.x);
+    const __m128 originY = _mm_set1_ps(origin.y);
+    const __m128 invX = _mm_set1_ps(invDirection.x);
+    const __m128 invY = _mm_set1_ps(invDirection.y);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 nearest = _mm_set1_ps(best);
+
+    for (; i + 4 <= size; i += 4) {
+      __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&bounds.left[i]), originX), invX);
+      __m128 tx2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&bounds.right[i]), originX), invX);
+      __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&bounds.top[i]), originY), invY);
+      __m128 ty2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&bounds.bottom[i]), originY), invY);
+
+      __m128 tMin = _mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2));
+      __m128 tMax = _mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2));
+
+      __m128 inFront = _mm_cmpge_ps(tMin, zero);
+      __m128 t = _mm_or_ps(_mm_and_ps(inFront, tMin), _mm_andnot_ps(inFront, tMax));
+      __m128 hit = _mm_and_ps(_mm_cmpge_ps(tMax, zero), _mm_cmple_ps(tMin, tMax));
+      nearest = _mm_min_ps(nearest, _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, nearest)));
+    }
+
+    nearest = _mm_min_ps(nearest, _mm_shuffle_ps(nearest, nearest, _MM_SHUFFLE(2, 3, 0, 1)));
+    nearest = _mm_min_ps(nearest, _mm_shuffle_ps(nearest, nearest, _MM_SHUFFLE(1, 0, 3, 2)));
+    best = _mm_cvtss_f32(nearest);
+  }
+#endif
+
+  for (; i < size; ++i)
+    best = std::min(best, slabDistance(origin, invDirection, bounds.left[i], bounds.top[i], bounds.right[i], bounds.bottom[i]));
+  return best;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// WallGrid
+//--------------------------------------------------------------------------------------------------------------
+
+// Uniform grid over the wall bounding boxes. Every wall is registered in each cell its bounds overlap, so a ray
+// only has to test the walls of the cells it passes through.
+struct WallGrid {
+  WallGrid(float cellSize = 200) : cellSize_(cellSize) {}
+
+  void insert(Object* pWall);
+  void update(Object* pWall); // wall has been moved or resized
+  void remove(Object* pWall);
+  void clear();
+
+  // Walks the cells along the ray in order and tests their walls in batches.
+  // Returns the nearest hit, or maxDist when nothing is hit closer.
+  float raycast(Vector2f origin, Vector2f direction, float maxDist) const;
+
+  // Calls f(bounds) once for every wall whose bounds overlap area.
+  template <typename F>
+  void query(const FloatRect& area, F&& f) const;
+
+  std::size_t size() const { return ranges_.size(); }
+  unsigned version() const { return version_; } // changes whenever a wall is inserted, moved or removed
+
+private:
+  static std::int64_t key(int x, int y) { return ((std::int64_t)x << 32) | (std::uint32_t)y; }
+  int cell(float v) const { return (int)std::floor(v / cellSize_); }
+  IntRect cellRange(Object* pWall) const; // left/top = first cell, width/height = last cell
+
+  struct Cell {
+    std::vector<Object*> walls;
+    WallBounds bounds; // same order as walls
+  };
+
+  float cellSize_;
+  unsigned version_{0};
+  std::unordered_map<std::int64_t, Cell> cells_;
+  std::unordered_map<const Object*, IntRect> ranges_;
+
+  // cells that have ever been occupied, rays stop once they leave them
+  int minX_{std::numeric_limits<int>::max()};
+  int minY_{std::numeric_limits<int>::max()};
+  int maxX_{std::numeric_limits<int>::min()};
+  int maxY_{std::numeric_limits<int>::min()};
+};
+
+//------ query ------
+template <typename F>
+void WallGrid::query(const FloatRect& area, F&& f) const {
+  int left = std::max(cell(area.left), minX_);
+  int top = std::max(cell(area.top), minY_);
+  int right = std::min(cell(area.left + area.width), maxX_);
+  int bottom = std::min(cell(area.top + area.height), maxY_);
+
+  for (int x = left; x <= right; ++x) {
+    for (int y = top; y <= bottom; ++y) {
+      auto it = cells_.find(key(x, y));
+      if (it == cells_.end())
+        continue;
+      const WallBounds& bounds = it->second.bounds;
+      for (std::size_t i = 0; i < bounds.size(); ++i) {
+        if (bounds.right[i] < area.left || bounds.left[i] > area.left + area.width ||
+            bounds.bottom[i] < area.top || bounds.top[i] > area.top + area.height)
+          continue;
+        // a wall spanning several cells is reported by the first of them inside the queried range only
+        if (std::max(cell(bounds.left[i]), left) != x || std::max(cell(bounds.top[i]), top) != y)
+          continue;
+        f(FloatRect(bounds.left[i], bounds.top[i], bounds.right[i] - bounds.left[i], bounds.bottom[i] - bounds.top[i]));
+      }
+    }
+  }
+}
+
+} // end of namespace sf
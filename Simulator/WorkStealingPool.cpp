@@ -0,0 +1,93 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+//--------------------------------------------------------------------------------------------------------------
+// WorkStealingPool
+//--------------------------------------------------------------------------------------------------------------
+
+//------ WorkStealingPool ------
+WorkStealingPool::WorkStealingPool(unsigned threads) {
+  threads = std::max(threads, 1u);
+  for (unsigned i = 0; i < threads; ++i)
+    queues_.push_back(std::make_unique<Queue>());
+  for (unsigned i = 0; i < threads; ++i)
+    threads_.emplace_back(&WorkStealingPool::work, this, i);
+}
+
+//------ ~WorkStealingPool ------
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto& thread : threads_)
+    thread.join();
+}
+
+//------ submit ------
+void WorkStealingPool::submit(std::function<void()> task) {
+  Queue& queue = *queues_[next_++ % queues_.size()];
+  {
+    std::lock_guard lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard lock(mutex_);
+    ++queued_;
+    ++pending_;
+  }
+  wake_.notify_one();
+}
+
+//------ wait ------
+void WorkStealingPool::wait() {
+  std::unique_lock lock(mutex_);
+  idle_.wait(lock, [this] { return pending_ == 0; });
+}
+
+//------ work ------
+void WorkStealingPool::work(unsigned worker) {
+  while (true) {
+    {
+      std::unique_lock lock(mutex_);
+      wake_.wait(lock, [this] { return stop_ || queued_ > 0; });
+      if (queued_ == 0)
+        return; // stopped
+      --queued_; // claims one of the queued tasks, it is in one of the queues
+    }
+
+    std::function<void()> task;
+    while (!pop(worker, task)) {}
+    task();
+
+    std::lock_guard lock(mutex_);
+    if (--pending_ == 0)
+      idle_.notify_all();
+  }
+}
+
+//------ pop ------
+// Newest task of the own queue, otherwise the oldest task of the next non-empty queue.
+bool WorkStealingPool::pop(unsigned worker, std::function<void()>& task) {
+  {
+    Queue& own = *queues_[worker];
+    std::lock_guard lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  for (std::size_t i = 1; i < queues_.size(); ++i) {
+    Queue& victim = *queues_[(worker + i) % queues_.size()];
+    std::lock_guard lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
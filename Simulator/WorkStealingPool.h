@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+//--------------------------------------------------------------------------------------------------------------
+// WorkStealingPool
+//--------------------------------------------------------------------------------------------------------------
+
+// Fixed set of worker threads, each with its own task queue. A worker takes the newest task of its own queue and
+// steals the oldest task of another queue once its own runs dry, so long and short tasks even out across cores.
+struct WorkStealingPool {
+  explicit WorkStealingPool(unsigned threads = std::thread::hardware_concurrency());
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator = (const WorkStealingPool&) = delete;
+
+  void submit(std::function<void()> task); // tasks must not throw
+  void wait(); // blocks until every submitted task has finished
+
+  unsigned size() const { return (unsigned)threads_.size(); }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void work(unsigned worker);
+  bool pop(unsigned worker, std::function<void()>& task);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<unsigned> next_{0}; // queue of the next submit
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::size_t queued_{0};  // tasks not yet claimed by a worker
+  std::size_t pending_{0}; // tasks not yet finished
+  bool stop_{false};
+};
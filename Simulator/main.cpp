@@ -1,7 +1,12 @@
 #include "Simulator.h"
-#include "PathfindingSim.h"
+#include "PathFindingSim.h"
+#include "SimulationClock.h"
+#include "MazeIO.h"
 
 #include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <chrono>
 
 using namespace sf;
 
@@ -9,69 +14,129 @@ using namespace sf;
 // main
 //--------------------------------------------------------------------------------------------------------------
 
-void eventLoop() {
-  Simulator sim{};
+// F2 saves the maze to savePath in saveFormat
+void eventLoop(const Maze& maze, const std::filesystem::path& savePath, MazeFormat saveFormat) {
+  Simulator sim(false, maze);
+  sim.window->setVerticalSyncEnabled(true);
   bool automatic = false;
   PathFinderSim pathFind(((Car*)sim.car.get()));
+  pathFind.setListener([&](const PathFinder::Event& event) {
+    if (event.type != PathFinder::Event::Type::NODE_CREATED)
+      return;
+    sim.addNode(std::shared_ptr<Drawable>(new DrawNode(((Object*)sim.car.get())->shape()->getPosition(),
+      [&](Object* pThis) -> Object* {
+         pathFind.setGoal(pathFind.node(((DrawNode*)(pThis))->id));
+         return nullptr; },
+      event.node)));
+  });
 
-  while (sim.window.isOpen()) {
+  // + / - doubles / halves the simulation speed, 0 runs it as fast as possible, 1 resets it to real time
+  SimulationClock clock;
+  auto lastFrame = std::chrono::steady_clock::now();
+  Vector2f previousCarPos = ((Object*)sim.car.get())->shape()->getPosition(); // before the last search() step
+
+  while (sim.window->isOpen()) {
     Event event;
-    while (sim.window.pollEvent(event)) {
+    while (sim.window->pollEvent(event)) {
       if (event.type == Event::Closed)
-        sim.window.close();
+        sim.window->close();
+      if (event.type == Event::KeyPressed) {
+        if (event.key.code == Keyboard::Add || event.key.code == Keyboard::Equal)
+          clock.faster();
+        else if (event.key.code == Keyboard::Subtract || event.key.code == Keyboard::Dash)
+          clock.slower();
+        else if (event.key.code == Keyboard::Num0)
+          clock.setSpeed(0);
+        else if (event.key.code == Keyboard::Num1)
+          clock.setSpeed(1);
+        else if (event.key.code == Keyboard::F2 && !saveMaze(savePath, sim.maze(), saveFormat))
+          std::cerr << "can not write maze " << savePath << "\n";
+      }
     }
 
-    sim.window.clear(Color::White);
+    auto now = std::chrono::steady_clock::now();
+    double frameTime = std::chrono::duration<double>(now - lastFrame).count();
+    lastFrame = now;
 
-    ((Car*)(sim.car.get()))->update();
+    Vector2f carPos = ((Object*)sim.car.get())->shape()->getPosition();
+    if (automatic) {
+      if (clock.unlimited()) {
+        auto budget = now + std::chrono::milliseconds(15); // leaves time to draw at 60 fps
+        while (std::chrono::steady_clock::now() < budget) {
+          for (int i = 0; i < 64; ++i)
+            pathFind.search();
+        }
+        carPos = previousCarPos = ((Object*)sim.car.get())->shape()->getPosition();
+      }
+      else {
+        for (long steps = clock.advance(frameTime); steps > 0; --steps) {
+          previousCarPos = ((Object*)sim.car.get())->shape()->getPosition();
+          pathFind.search();
+        }
+        carPos = ((Object*)sim.car.get())->shape()->getPosition();
+      }
+    }
+    else
+      previousCarPos = carPos;
+
+    sim.window->clear(Color::White);
 
-    for (auto& pDrawable : sim.clickables)
-      sim.window.draw(*pDrawable);
+    ((Car*)(sim.car.get()))->update(pathFind.sensorReadings());
+
+    // the car is drawn between its last two simulated positions
+    RenderStates carStates;
+    carStates.transform.translate((previousCarPos - carPos) * (1.0f - clock.alpha()));
+    sim.draw(carStates);
 
     if (Keyboard::isKeyPressed(Keyboard::Space))
       automatic = true;
     if (Keyboard::isKeyPressed(Keyboard::BackSpace))
       automatic = false;
-    if (Keyboard::isKeyPressed(Keyboard::F2)) {
-      std::ofstream file;
-      file.open("C:/Users/Admin/Documents/Sketching with hardware/labyrinth.txt");
-      for (auto wall : sim.walls) {
-        file << "{{ " << ((Object*)(wall.get()))->x() << ", " << ((Object*)(wall.get()))->y() << " }, " << ((Wall*)(wall.get()))->horizontal() << " }," << "\n";
-      }
-      file.close();
-    }
 
-    if (automatic) {
-      pathFind.search();
-      if (auto pNode = pathFind.newNode()) {
-        sim.clickables.push_back(std::shared_ptr<Drawable>(new DrawNode(((Object*)sim.car.get())->shape()->getPosition(),
-          [&](Object* pThis) -> Object* {
-             pathFind.setGoal(*((DrawNode*)(pThis))->pNode);
-             return nullptr; },
-          pNode)));
-      }
-    }
     std::vector<std::shared_ptr<Drawable>> appendClickables;
     for (auto& pClicked : sim.clickables) {
-      if (auto&& draw = (((Object*)pClicked.get())->isClicked(&sim.window));
+      if (auto&& draw = (((Object*)pClicked.get())->isClicked(&*sim.window));
           draw != nullptr) {
         appendClickables.push_back(std::shared_ptr<Drawable>(draw));
       }
     }
-    sim.clickables.append_range(appendClickables);
-    sim.walls.append_range(appendClickables);
+    for (auto& pWall : appendClickables)
+      sim.addWall(pWall);
 
     if (!automatic)
       ((Object*)sim.car.get())->keyBoardMove();
-    sim.window.display();
+    sim.window->display();
   }
 }
 
-int main() {
+// usage: Simulator [--maze file] [--save file] [--format text|binary]
+int main(int argc, char* argv[]) {
+  Maze maze = defaultMaze();
+  std::filesystem::path savePath = "labyrinth.txt";
+  MazeFormat saveFormat = MazeFormat::TEXT;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "--maze") {
+      auto loaded = loadMaze(argv[i + 1]);
+      if (!loaded.has_value())
+        throw std::runtime_error(std::string("Failed to load maze ") + argv[i + 1]);
+      maze = std::move(loaded.value());
+    }
+    else if (arg == "--save")
+      savePath = argv[i + 1];
+    else if (arg == "--format") {
+      auto format = parseMazeFormat(argv[i + 1]);
+      if (!format.has_value())
+        throw std::runtime_error(std::string("Unknown maze format ") + argv[i + 1]);
+      saveFormat = format.value();
+    }
+  }
+
   if (!font_.loadFromFile("arial.ttf")) {
     throw std::runtime_error("Failed to load font");
   }
-  eventLoop();
+  eventLoop(maze, savePath, saveFormat);
 
   return 0;
 }
\ No newline at end of file